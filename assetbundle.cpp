@@ -0,0 +1,315 @@
+#include "assetbundle.h"
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QRegularExpression>
+#include <QThread>
+#include <QtConcurrent>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const int HashNameLength = 16;  // SHA-256 的前 64 位，十六进制
+
+#ifdef Q_OS_LINUX
+// 同一文件系统支持时直接共享数据块（btrfs、xfs 等），否则由内核在页缓存之间复制。
+// 返回 false 表示两者都不可用，由调用方退回普通复制
+bool copyInKernel(const QString &from, const QString &to)
+{
+    int in = ::open(QFile::encodeName(from).constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        return false;
+    int out = ::open(QFile::encodeName(to).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+
+    bool ok = ::ioctl(out, FICLONE, in) == 0;
+    if (!ok) {
+        struct stat info;
+        ok = ::fstat(in, &info) == 0;
+        off_t remaining = ok ? info.st_size : 0;
+        while (ok && remaining > 0) {
+            ssize_t copied = ::copy_file_range(in, nullptr, out, nullptr, size_t(remaining), 0);
+            if (copied < 0 && errno == EINTR)
+                continue;
+            if (copied <= 0)
+                ok = false;  // EXDEV、ENOSYS 等，或文件在复制途中被截短
+            else
+                remaining -= copied;
+        }
+    }
+    ok = ::close(out) == 0 && ok;
+    ::close(in);
+    if (!ok)
+        ::unlink(QFile::encodeName(to).constData());
+    return ok;
+}
+#endif
+
+bool copyFile(const QString &from, const QString &to)
+{
+#ifdef Q_OS_LINUX
+    if (copyInKernel(from, to))
+        return true;
+#endif
+    return QFile::copy(from, to);
+}
+}
+
+AssetBundle::AssetBundle(const QString &outputDir, const QString &subdir)
+    : outputDir(outputDir), subdir(subdir)
+{
+}
+
+void AssetBundle::setInlineLimit(qint64 bytes)
+{
+    limit = qMax<qint64>(0, bytes);
+}
+
+qint64 AssetBundle::inlineLimit() const
+{
+    return limit;
+}
+
+QString AssetBundle::relativePath(const QString &name) const
+{
+    return subdir + '/' + name;
+}
+
+QString AssetBundle::absolutePath(const QString &name) const
+{
+    return outputDir + '/' + subdir + '/' + name;
+}
+
+QString AssetBundle::hashedName(const QByteArray &hash, const QString &suffix)
+{
+    QString name = QString::fromLatin1(hash.toHex().left(HashNameLength));
+    return name + '.' + (suffix.isEmpty() ? QString("bin") : suffix.toLower());
+}
+
+QString AssetBundle::dataUri(const QByteArray &data)
+{
+    QString mime = QMimeDatabase().mimeTypeForData(data).name();
+    return "data:" + mime + ";base64," + QString::fromLatin1(data.toBase64());
+}
+
+QString AssetBundle::partPath(const QString &target)
+{
+    // 多个导出可能同时写同一目录（批量导出的各页面，或同时运行的多个进程），
+    // 临时文件名按进程和线程区分
+    return target + '.' + QString::number(QCoreApplication::applicationPid(), 16) + '-'
+           + QString::number(quintptr(QThread::currentThreadId()), 16) + ".part";
+}
+
+bool AssetBundle::publish(const QString &part, const QString &target)
+{
+    if (QFile::rename(part, target))
+        return true;
+    // 另一个导出刚写入了同名文件，内容相同，丢弃自己的副本
+    if (QFileInfo::exists(target)) {
+        QFile::remove(part);
+        return true;
+    }
+    return false;
+}
+
+bool AssetBundle::claim(const QString &name)
+{
+    QMutexLocker locker(&mutex);
+    if (files.contains(name))
+        return false;
+    files.insert(name);
+    return true;
+}
+
+void AssetBundle::add(const QString &source)
+{
+    if (!source.isEmpty() && !sources.contains(source))
+        sources.insert(source, QString());
+}
+
+QString AssetBundle::addFile(const QString &path, QString *error)
+{
+    TraceSpan span("bundle asset", "export");
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = path + ": " + file.errorString();
+        return QString();
+    }
+    const qint64 size = file.size();
+    if (size < limit) {
+        {
+            QMutexLocker locker(&mutex);
+            ++inlined;
+        }
+        return dataUri(file.readAll());
+    }
+
+    // 映射文件计算哈希，不把整张图片读进堆内存
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (uchar *mapped = size > 0 ? file.map(0, size) : nullptr) {
+        hash.addData(QByteArrayView(reinterpret_cast<const char *>(mapped), size));
+        file.unmap(mapped);
+    } else if (!hash.addData(&file)) {
+        *error = path + ": " + file.errorString();
+        return QString();
+    }
+    file.close();
+
+    QString name = hashedName(hash.result(), QFileInfo(path).suffix());
+    QString target = absolutePath(name);
+    // 同名即同内容：其他线程或上一次导出已经写入的文件直接复用
+    if (claim(name) && !QFileInfo::exists(target)) {
+        QString part = partPath(target);
+        if (!copyFile(path, part) || !publish(part, target)) {
+            QFile::remove(part);
+            *error = path + ": cannot copy to " + target;
+            QMutexLocker locker(&mutex);
+            files.remove(name);
+            failedNames.insert(name, "cannot copy to " + target);
+            return QString();
+        }
+    }
+    return relativePath(name);
+}
+
+QString AssetBundle::addData(const QByteArray &data, const QString &suffix, QString *error)
+{
+    if (data.size() < limit) {
+        {
+            QMutexLocker locker(&mutex);
+            ++inlined;
+        }
+        return dataUri(data);
+    }
+
+    QString name = hashedName(QCryptographicHash::hash(data, QCryptographicHash::Sha256), suffix);
+    QString target = absolutePath(name);
+    // 数据已在内存中，文件还不存在时不论是否抢到都自己写一份：另一个线程可能还在写，
+    // 也可能写入失败，返回的地址必须指向已经存在的文件
+    claim(name);
+    if (!QFileInfo::exists(target)) {
+        QFile file(partPath(target));
+        bool ok = QDir(outputDir).mkpath(subdir) && file.open(QIODevice::WriteOnly)
+                  && file.write(data) == data.size();
+        file.close();
+        if (!ok || !publish(file.fileName(), target)) {
+            if (error)
+                *error = target + ": " + file.errorString();
+            file.remove();
+            return QString();
+        }
+        QMutexLocker locker(&mutex);
+        files.insert(name);  // 先抢到的线程失败时可能已经移除
+    }
+    return relativePath(name);
+}
+
+bool AssetBundle::build(bool parallel)
+{
+    TraceSpan span("build asset bundle", "export");
+    if (sources.isEmpty())
+        return true;
+    if (!QDir(outputDir).mkpath(subdir)) {
+        QMutexLocker locker(&mutex);
+        failures.append("cannot create " + absolutePath(QString()));
+        return false;
+    }
+
+    struct Job {
+        QString source;
+        QString url;
+        QString error;
+    };
+    QVector<Job> jobs;
+    jobs.reserve(sources.size());
+    for (auto it = sources.cbegin(); it != sources.cend(); ++it) {
+        if (it.value().isEmpty())
+            jobs.append({ it.key(), QString(), QString() });
+    }
+
+    auto run = [this](Job &job) { job.url = addFile(job.source, &job.error); };
+    if (parallel) {
+        QtConcurrent::blockingMap(jobs, run);
+    } else {
+        for (Job &job : jobs)
+            run(job);
+    }
+
+    bool ok = true;
+    const QString prefix = subdir + '/';
+    for (Job &job : jobs) {
+        // claim() 失败的任务没有自己复制，而是假定先抢到的线程会写好文件；
+        // 那次复制失败时这里补上错误，不让页面引用不存在的文件
+        if (job.url.startsWith(prefix)) {
+            QString name = job.url.mid(prefix.size());
+            if (!QFileInfo::exists(absolutePath(name))) {
+                QMutexLocker locker(&mutex);
+                job.error = job.source + ": " + failedNames.value(name, absolutePath(name) + " is missing");
+                job.url.clear();
+            }
+        }
+        sources[job.source] = job.url;
+        if (job.url.isEmpty()) {
+            ok = false;
+            QMutexLocker locker(&mutex);
+            failures.append(job.error);
+        }
+    }
+    return ok;
+}
+
+bool AssetBundle::resolve(const HtmlExporter::ItemSnapshot &item, HtmlExporter::ImageRef *ref) const
+{
+    auto it = sources.constFind(item.content);
+    if (it == sources.cend() || it.value().isEmpty())
+        return false;
+    ref->src = it.value();
+    ref->srcset.clear();
+    ref->sizes.clear();
+    return true;
+}
+
+void AssetBundle::prune()
+{
+    static const QRegularExpression pattern(QString("^[0-9a-f]{%1}\\.[a-z0-9]+(\\.[0-9a-f]+-[0-9a-f]+\\.part)?$").arg(HashNameLength));
+    QDir dir(outputDir + '/' + subdir);
+    const QStringList entries = dir.entryList(QDir::Files);
+    QMutexLocker locker(&mutex);
+    for (const QString &entry : entries) {
+        // 只删除本类生成的文件名，目录里的其他文件不动
+        if (!files.contains(entry) && pattern.match(entry).hasMatch())
+            dir.remove(entry);
+    }
+}
+
+int AssetBundle::fileCount() const
+{
+    QMutexLocker locker(&mutex);
+    return files.size();
+}
+
+int AssetBundle::inlineCount() const
+{
+    QMutexLocker locker(&mutex);
+    return inlined;
+}
+
+QStringList AssetBundle::errors() const
+{
+    QMutexLocker locker(&mutex);
+    return failures;
+}
@@ -0,0 +1,60 @@
+#ifndef ASSETBUNDLE_H
+#define ASSETBUNDLE_H
+
+#include "htmlexporter.h"
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// 自包含导出：页面引用的图片按内容哈希去重后放进 outputDir/subdir，
+// 文件名就是哈希，内容不变地址就不变，可设置长期缓存；小于阈值的图片直接内嵌为 data URI。
+// 复制优先使用 reflink（FICLONE）或 copy_file_range，在内核中完成，不经过用户态缓冲区
+class AssetBundle
+{
+public:
+    explicit AssetBundle(const QString &outputDir, const QString &subdir = "assets");
+
+    void setInlineLimit(qint64 bytes);  // 默认 4KB，0 表示不内嵌
+    qint64 inlineLimit() const;
+
+    // 收集需要原样打包的图片；build() 并行计算哈希并复制，之后 resolve() 只读查询
+    void add(const QString &source);
+    bool build(bool parallel = true);
+    bool resolve(const HtmlExporter::ItemSnapshot &item, HtmlExporter::ImageRef *ref) const;
+
+    // 打包内存中的数据（如重新编码的图片），返回页面中使用的地址，失败时为空。
+    // 可在多个线程中同时调用
+    QString addData(const QByteArray &data, const QString &suffix, QString *error = nullptr);
+
+    // 删除子目录中本次没有引用的旧文件；只用于单个页面独占的目录
+    void prune();
+
+    int fileCount() const;
+    int inlineCount() const;
+    QStringList errors() const;
+
+private:
+    QString addFile(const QString &path, QString *error);
+    bool claim(const QString &name);  // 第一个写入该文件的线程返回 true
+    static QString partPath(const QString &target);
+    static bool publish(const QString &part, const QString &target);
+    QString relativePath(const QString &name) const;
+    QString absolutePath(const QString &name) const;
+    static QString hashedName(const QByteArray &hash, const QString &suffix);
+    static QString dataUri(const QByteArray &data);
+
+    QString outputDir;
+    QString subdir;
+    qint64 limit = 4 * 1024;
+    QHash<QString, QString> sources;  // 原图路径 → 页面中的地址
+
+    mutable QMutex mutex;  // 保护以下成员
+    QSet<QString> files;
+    int inlined = 0;
+    QStringList failures;
+    QHash<QString, QString> failedNames;  // 复制失败的文件名 → 错误信息
+};
+
+#endif // ASSETBUNDLE_H
@@ -0,0 +1,318 @@
+#include "autosavejournal.h"
+#include "binarylayout.h"
+#include "layouteditor.h"
+#include "layouteditoritem.h"
+#include "textitem.h"
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QGraphicsItemGroup>
+#include <QMap>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// 日志文件头（16 字节）：magic "HLJN"、u32 版本、u64 快照代号；
+// 之后是若干帧，每帧为 u32 长度加一次保存写出的记录，最后一帧不完整时忽略
+const char Magic[4] = { 'H', 'L', 'J', 'N' };
+const quint32 Version = 1;
+const int HeaderSize = 16;
+const qint64 MinCompactBytes = 256 * 1024;
+
+void prepare(QDataStream &stream)
+{
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+}
+
+void writeRecord(QDataStream &out, const LayoutRecord &record)
+{
+    out << quint8(record.type) << record.pos << record.size << record.content
+        << record.fontFamily << qint32(record.fontSize) << record.bold
+        << record.hasColor << quint32(record.color);
+}
+
+void readRecord(QDataStream &in, LayoutRecord *record)
+{
+    quint8 type;
+    qint32 fontSize;
+    quint32 color;
+    in >> type >> record->pos >> record->size >> record->content
+       >> record->fontFamily >> fontSize >> record->bold
+       >> record->hasColor >> color;
+    record->type = type == LayoutRecord::Text ? LayoutRecord::Text : LayoutRecord::Image;
+    record->fontSize = fontSize;
+    record->color = color;
+}
+
+bool sameStyle(const LayoutRecord &a, const LayoutRecord &b)
+{
+    return a.fontFamily == b.fontFamily && a.fontSize == b.fontSize && a.bold == b.bold
+           && a.hasColor == b.hasColor && a.color == b.color;
+}
+}
+
+void AutosaveJournal::setBasePath(const QString &basePath)
+{
+    if (basePath == base)
+        return;
+    if (retiredBase.isEmpty())
+        retiredBase = base;
+    base = basePath;
+    needsSnapshot = true;
+}
+
+QString AutosaveJournal::basePath() const
+{
+    return base;
+}
+
+QString AutosaveJournal::snapshotPath(const QString &path) const
+{
+    return path + ".autosave.hlb";
+}
+
+QString AutosaveJournal::journalPath(const QString &path) const
+{
+    return path + ".autosave.log";
+}
+
+bool AutosaveJournal::tracks(const QGraphicsItem *item)
+{
+    return dynamic_cast<const LayoutEditorItem *>(item) || dynamic_cast<const TextItem *>(item);
+}
+
+void AutosaveJournal::markChanged(QGraphicsItem *item)
+{
+    if (!ids.contains(item)) {
+        if (!tracks(item)) {
+            // 组合移动时子项没有位置变化通知，由组合代为登记
+            if (qgraphicsitem_cast<QGraphicsItemGroup *>(item)) {
+                const QList<QGraphicsItem *> children = item->childItems();
+                for (QGraphicsItem *child : children)
+                    markChanged(child);
+            }
+            return;
+        }
+        ids.insert(item, nextId++);  // 编号递增，回放时按编号排列即保持叠放顺序
+    }
+    dirty.insert(item);
+}
+
+void AutosaveJournal::markRemoved(QGraphicsItem *item)
+{
+    dirty.remove(item);
+    auto it = ids.find(item);
+    if (it == ids.end())
+        return;
+    quint32 id = it.value();
+    ids.erase(it);
+    if (saved.remove(id))
+        removed.append(id);
+}
+
+void AutosaveJournal::reset()
+{
+    ids.clear();
+    saved.clear();
+    dirty.clear();
+    removed.clear();
+    nextId = 0;
+    needsSnapshot = true;
+}
+
+bool AutosaveJournal::needsCompaction() const
+{
+    return needsSnapshot || journalBytes > qMax(MinCompactBytes, snapshotBytes);
+}
+
+bool AutosaveJournal::flush()
+{
+    if (base.isEmpty() || needsSnapshot)
+        return false;
+    if (dirty.isEmpty() && removed.isEmpty())
+        return true;
+
+    QByteArray frame(4, '\0');
+    QDataStream out(&frame, QIODevice::WriteOnly | QIODevice::Append);
+    prepare(out);
+
+    for (quint32 id : std::as_const(removed))
+        out << quint8(Remove) << id;
+
+    QVector<QPair<quint32, QGraphicsItem *>> changed;
+    changed.reserve(dirty.size());
+    for (QGraphicsItem *item : std::as_const(dirty))
+        changed.append(qMakePair(ids.value(item), item));
+    std::sort(changed.begin(), changed.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    for (const auto &entry : std::as_const(changed)) {
+        quint32 id = entry.first;
+        LayoutRecord record;
+        if (!LayoutEditor::itemRecord(entry.second, &record))
+            continue;
+
+        auto prev = saved.find(id);
+        if (prev == saved.end()) {
+            out << quint8(Add) << id;
+            writeRecord(out, record);
+            saved.insert(id, record);
+            continue;
+        }
+        if (prev->pos != record.pos)
+            out << quint8(Move) << id << record.pos;
+        if (prev->size != record.size)
+            out << quint8(Resize) << id << record.size;
+        if (prev->content != record.content)
+            out << quint8(Text) << id << record.content;
+        if (!sameStyle(*prev, record))
+            out << quint8(Style) << id << record.fontFamily << qint32(record.fontSize)
+                << record.bold << record.hasColor << quint32(record.color);
+        *prev = record;
+    }
+    dirty.clear();
+    removed.clear();
+
+    if (frame.size() == 4)
+        return true;  // 只有位置来回移动等没有实际变化的登记
+    qToLittleEndian<quint32>(quint32(frame.size() - 4), frame.data());
+
+    QFile file(journalPath(base));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append) || file.write(frame) != frame.size()) {
+        needsSnapshot = true;  // 日志可能已不完整，下次改写快照
+        return false;
+    }
+    journalBytes += frame.size();
+    return true;
+}
+
+bool AutosaveJournal::compact(const QList<QGraphicsItem *> &items)
+{
+    if (base.isEmpty())
+        return false;
+
+    quint64 newGeneration = QRandomGenerator::global()->generate64();
+    BinaryLayout::Writer writer;
+    writer.setTag(newGeneration);
+
+    QHash<QGraphicsItem *, quint32> newIds;
+    QHash<quint32, LayoutRecord> newSaved;
+    quint32 count = 0;
+    for (QGraphicsItem *item : items) {
+        LayoutRecord record;
+        if (!tracks(item) || !LayoutEditor::itemRecord(item, &record))
+            continue;
+        writer.addItem(record);
+        newIds.insert(item, count);
+        newSaved.insert(count, record);
+        ++count;
+    }
+    if (!writer.save(snapshotPath(base)))
+        return false;
+
+    QByteArray header(HeaderSize, '\0');
+    memcpy(header.data(), Magic, sizeof(Magic));
+    qToLittleEndian<quint32>(Version, header.data() + 4);
+    qToLittleEndian<quint64>(newGeneration, header.data() + 8);
+    QSaveFile journal(journalPath(base));
+    if (!journal.open(QIODevice::WriteOnly) || journal.write(header) != header.size() || !journal.commit())
+        return false;  // 快照已更新而日志仍是旧代号，回放时只用快照
+
+    ids = newIds;
+    saved = newSaved;
+    nextId = count;
+    dirty.clear();
+    removed.clear();
+    journalBytes = HeaderSize;
+    snapshotBytes = QFileInfo(snapshotPath(base)).size();
+    needsSnapshot = false;
+
+    if (!retiredBase.isEmpty() && retiredBase != base) {
+        QFile::remove(snapshotPath(retiredBase));
+        QFile::remove(journalPath(retiredBase));
+    }
+    retiredBase.clear();
+    return true;
+}
+
+bool AutosaveJournal::restore(QVector<LayoutRecord> *records) const
+{
+    if (base.isEmpty())
+        return false;
+
+    QMap<quint32, LayoutRecord> state;  // 按编号排序即叠放顺序
+    quint64 tag;
+    {
+        BinaryLayout::Reader reader;
+        if (!reader.open(snapshotPath(base)))
+            return false;
+        const int count = reader.itemCount();
+        for (int i = 0; i < count; ++i)
+            state.insert(quint32(i), reader.item(i));
+        tag = reader.tag();
+    }
+
+    QFile file(journalPath(base));
+    QByteArray journal = file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    bool valid = journal.size() >= HeaderSize && memcmp(journal.constData(), Magic, sizeof(Magic)) == 0
+                 && qFromLittleEndian<quint32>(journal.constData() + 4) == Version
+                 && qFromLittleEndian<quint64>(journal.constData() + 8) == tag;
+
+    qsizetype at = HeaderSize;
+    while (valid && at + 4 <= journal.size()) {
+        quint32 length = qFromLittleEndian<quint32>(journal.constData() + at);
+        if (length > journal.size() - at - 4)
+            break;  // 写入中断的最后一帧
+        QByteArray payload = QByteArray::fromRawData(journal.constData() + at + 4, length);
+        at += 4 + length;
+
+        QDataStream in(payload);
+        prepare(in);
+        while (!in.atEnd() && in.status() == QDataStream::Ok) {
+            quint8 op;
+            quint32 id;
+            in >> op >> id;
+            LayoutRecord record;
+            LayoutRecord *target = state.contains(id) ? &state[id] : &record;
+            switch (op) {
+            case Add:
+                readRecord(in, &record);
+                state.insert(id, record);
+                break;
+            case Remove:
+                state.remove(id);
+                break;
+            case Move:
+                in >> target->pos;
+                break;
+            case Resize:
+                in >> target->size;
+                break;
+            case Text:
+                in >> target->content;
+                break;
+            case Style: {
+                qint32 fontSize;
+                quint32 color;
+                in >> target->fontFamily >> fontSize >> target->bold >> target->hasColor >> color;
+                target->fontSize = fontSize;
+                target->color = color;
+                break;
+            }
+            default:
+                in.setStatus(QDataStream::ReadCorruptData);
+                break;
+            }
+        }
+    }
+
+    records->clear();
+    records->reserve(state.size());
+    for (const LayoutRecord &record : std::as_const(state))
+        records->append(record);
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef AUTOSAVEJOURNAL_H
+#define AUTOSAVEJOURNAL_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include "layoutrecord.h"
+
+class QGraphicsItem;
+
+// 自动保存：项目旁边保存一份快照（.autosave.hlb，二进制布局格式）和一份追加写入的日志
+// （.autosave.log）。每次保存只把上次以来变化的图形项写成增量记录追加到日志末尾，
+// 日志超过快照大小时再整体写一次快照并清空日志。
+// 快照与日志头部记录同一个随机代号，写快照后中断时旧日志不会被误用
+class AutosaveJournal
+{
+public:
+    // 日志中的增量记录，除 Add 外只包含发生变化的字段
+    enum Op : quint8 {
+        Add = 1,
+        Remove,
+        Move,
+        Resize,
+        Text,
+        Style
+    };
+
+    void setBasePath(const QString &basePath);
+    QString basePath() const;
+
+    // 由编辑器在图形项变化时调用，只做登记
+    void markChanged(QGraphicsItem *item);
+    void markRemoved(QGraphicsItem *item);
+    void reset();  // 场景被整体清空，下次保存时重写快照
+
+    bool needsCompaction() const;
+    bool flush();                                       // 把登记的变化追加到日志
+    bool compact(const QList<QGraphicsItem *> &items);  // items 按叠放顺序从下到上
+    bool restore(QVector<LayoutRecord> *records) const; // 快照加日志，按叠放顺序返回
+
+private:
+    static bool tracks(const QGraphicsItem *item);
+    QString snapshotPath(const QString &base) const;
+    QString journalPath(const QString &base) const;
+
+    QString base;
+    QString retiredBase;  // 换了保存位置后，旧文件在新快照写好后删除
+    QHash<QGraphicsItem *, quint32> ids;
+    QHash<quint32, LayoutRecord> saved;  // 日志中已记录的最新状态，用于比较变化
+    QSet<QGraphicsItem *> dirty;
+    QVector<quint32> removed;
+    quint32 nextId = 0;
+    qint64 journalBytes = 0;
+    qint64 snapshotBytes = 0;
+    bool needsSnapshot = true;
+};
+
+#endif // AUTOSAVEJOURNAL_H
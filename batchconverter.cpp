@@ -0,0 +1,251 @@
+#include "batchconverter.h"
+#include "htmlexporter.h"
+#include "layouteditor.h"
+#include "assetbundle.h"
+#include "layoutrecord.h"
+#include "responsiveimages.h"
+#include "tracer.h"
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QHash>
+#include <QImageReader>
+#include <QMutex>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <cstring>
+#include <memory>
+
+namespace BatchConverter {
+
+namespace {
+struct Job {
+    QString input;
+    QString output;
+    bool ok = false;
+    QString error;
+    int items = 0;
+    qint64 elapsedNs = 0;
+};
+
+// 图片只读文件头取尺寸；同一批页面通常共用素材，结果在各线程间共享
+class ImageSizes
+{
+public:
+    QSize lookup(const QString &path)
+    {
+        {
+            QMutexLocker locker(&mutex);
+            auto it = sizes.constFind(path);
+            if (it != sizes.cend())
+                return it.value();
+        }
+        QImageReader reader(path);
+        reader.setDecideFormatFromContent(true);  // 与编辑器一样按内容识别格式
+        QSize size = reader.size();
+        if (!size.isValid()) {
+            // 有些格式不提供文件头尺寸，只能完整解码
+            QImageReader decoder(path);
+            decoder.setDecideFormatFromContent(true);
+            size = decoder.read().size();
+        }
+        QMutexLocker locker(&mutex);
+        sizes.insert(path, size);
+        return size;
+    }
+
+private:
+    QMutex mutex;
+    QHash<QString, QSize> sizes;
+};
+
+struct Options {
+    LayoutEditor::TextDefaults defaults;
+    bool responsiveImages = false;
+    // 打包导出：同一输出目录的页面共用 assets/，文件按内容命名，跨页面自然去重
+    bool bundle = false;
+    qint64 inlineLimit = 4 * 1024;
+    int fold = -1;  // 大于等于 0 时按位置排序并添加加载提示
+};
+
+// 与编辑器导出时相同：变体放在 <页面名>_images 目录，逐张的大小对比写入 report.tsv；
+// 打包导出时变体交给 bundle，报告放在页面旁边。
+// 各文件已经在并行转换，单个文件内的图片串行处理
+void buildImages(const Job &job, const QVector<HtmlExporter::ItemSnapshot> &items, ResponsiveImages *images,
+                 AssetBundle *bundle)
+{
+    images->setBundle(bundle);
+    for (const HtmlExporter::ItemSnapshot &item : items)
+        images->add(item);
+    images->build(false);
+
+    QFileInfo info(job.output);
+    QSaveFile report(bundle ? info.path() + "/" + info.completeBaseName() + "-images.tsv"
+                            : info.path() + "/" + info.completeBaseName() + "_images/report.tsv");
+    if (!images->assets().isEmpty() && report.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        report.write(images->report().toUtf8());
+        report.commit();
+    }
+}
+
+// 只打包页面实际引用的原图，已经重新编码的图片不再复制
+bool bundleImages(const QVector<HtmlExporter::ItemSnapshot> &items, const ResponsiveImages *images,
+                  AssetBundle *bundle, QString *error)
+{
+    HtmlExporter::ImageRef ref;
+    for (const HtmlExporter::ItemSnapshot &item : items) {
+        if (item.kind == HtmlExporter::ItemSnapshot::Image && !(images && images->resolve(item, &ref)))
+            bundle->add(item.content);
+    }
+    if (bundle->build(false))
+        return true;
+    *error = bundle->errors().join("; ");
+    return false;
+}
+
+void convert(Job &job, const Options &options, ImageSizes *imageSizes)
+{
+    TraceSpan span("convert layout", "export");
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(job.input);
+    QVector<LayoutRecord> records;
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        job.error = file.errorString();
+    } else if (!parseLayoutJson(file.readAll(), &records, &job.error)) {
+        if (job.error.isEmpty())
+            job.error = "invalid layout";
+    } else {
+        QVector<HtmlExporter::ItemSnapshot> items;
+        // 与编辑器导入同一文件后再导出的规则相同，由 LayoutEditor 统一提供
+        LayoutEditor::snapshotRecords(records, options.defaults,
+                                      [imageSizes](const QString &path) { return imageSizes->lookup(path); }, &items);
+        job.items = items.size();
+
+        HtmlExporter exporter;
+        QFileInfo info(job.output);
+        std::unique_ptr<AssetBundle> bundle;
+        if (options.bundle) {
+            bundle = std::make_unique<AssetBundle>(info.path());
+            bundle->setInlineLimit(options.inlineLimit);
+        }
+        ResponsiveImages images(info.path(), info.completeBaseName() + "_images");
+        if (options.responsiveImages)
+            buildImages(job, items, &images, bundle.get());
+        const ResponsiveImages *responsive = options.responsiveImages ? &images : nullptr;
+        bool ok = !bundle || bundleImages(items, responsive, bundle.get(), &job.error);
+        exporter.setImageResolver([responsive, &bundle](const HtmlExporter::ItemSnapshot &item, HtmlExporter::ImageRef *ref) {
+            return (responsive && responsive->resolve(item, ref)) || (bundle && bundle->resolve(item, ref));
+        });
+        exporter.setLoadingHints(options.fold);
+
+        QSaveFile out(job.output);
+        if (ok && (!out.open(QIODevice::WriteOnly) || !exporter.exportTo(&out, items) || !out.commit()))
+            job.error = out.errorString();
+        else
+            job.ok = ok;
+    }
+    job.elapsedNs = timer.nsecsElapsed();
+}
+}
+
+bool isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--export") == 0)
+            return true;
+    }
+    return false;
+}
+
+int run(int argc, char *argv[])
+{
+    // 不需要窗口系统，未指定平台时使用 offscreen
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Export layout JSON files to HTML without opening the editor.");
+    parser.addHelpOption();
+    parser.addOption({ "export", "Run the batch exporter." });
+    parser.addOption({ { "o", "output-dir" }, "Write HTML files to <dir> instead of next to the input.", "dir" });
+    parser.addOption({ { "j", "jobs" }, "Number of files converted in parallel.", "n" });
+    parser.addOption({ "trace", "Write a Chrome trace of the run to <file>.", "file" });
+    parser.addOption({ "responsive-images", "Re-encode images at their displayed size and 2x and emit srcset." });
+    parser.addOption({ "bundle", "Copy referenced images into assets/ next to the pages, named by content hash." });
+    parser.addOption({ "inline-limit", "With --bundle, inline images smaller than <bytes> as data URIs (default 4096).", "bytes" });
+    parser.addOption({ "fold", "Order elements by position; images above <y> load eagerly, the rest lazily.", "y" });
+    parser.addPositionalArgument("files", "Layout JSON files.", "files...");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const QStringList inputs = parser.positionalArguments();
+    if (inputs.isEmpty()) {
+        err << "no input files\n";
+        return 2;
+    }
+
+    QString outputDir = parser.value("output-dir");
+    if (!outputDir.isEmpty() && !QDir().mkpath(outputDir)) {
+        err << "cannot create " << outputDir << "\n";
+        return 2;
+    }
+    int threads = parser.value("jobs").toInt();
+    if (threads > 0)
+        QThreadPool::globalInstance()->setMaxThreadCount(threads);
+
+    QVector<Job> jobs;
+    jobs.reserve(inputs.size());
+    for (const QString &input : inputs) {
+        QFileInfo info(input);
+        Job job;
+        job.input = input;
+        job.output = (outputDir.isEmpty() ? info.path() : outputDir) + "/" + info.completeBaseName() + ".html";
+        jobs.append(job);
+    }
+
+    LayoutEditor::TextDefaults defaults = LayoutEditor::textDefaults();
+    ImageSizes imageSizes;
+
+    QElapsedTimer wall;
+    wall.start();
+    Options options;
+    options.defaults = defaults;
+    options.responsiveImages = parser.isSet("responsive-images");
+    options.bundle = parser.isSet("bundle");
+    if (parser.isSet("inline-limit"))
+        options.inlineLimit = parser.value("inline-limit").toLongLong();
+    if (parser.isSet("fold"))
+        options.fold = qMax(0, parser.value("fold").toInt());
+    QtConcurrent::blockingMap(jobs, [&options, &imageSizes](Job &job) {
+        convert(job, options, &imageSizes);
+    });
+    qint64 wallNs = wall.nsecsElapsed();
+
+    // 每行：耗时（毫秒）、图形项数、结果、输入文件、输出文件或错误信息
+    int failed = 0;
+    qint64 totalNs = 0;
+    for (const Job &job : std::as_const(jobs)) {
+        totalNs += job.elapsedNs;
+        if (!job.ok)
+            ++failed;
+        out << QString::number(job.elapsedNs / 1e6, 'f', 2) << "\t" << job.items << "\t"
+            << (job.ok ? "ok" : "failed") << "\t" << job.input << "\t"
+            << (job.ok ? job.output : job.error) << "\n";
+    }
+    out << "total\t" << jobs.size() << " files\t" << failed << " failed\t"
+        << QString::number(totalNs / 1e6, 'f', 2) << " ms summed\t"
+        << QString::number(wallNs / 1e6, 'f', 2) << " ms wall\t"
+        << QThreadPool::globalInstance()->maxThreadCount() << " threads\n";
+    return failed ? 1 : 0;
+}
+
+}
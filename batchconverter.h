@@ -0,0 +1,14 @@
+#ifndef BATCHCONVERTER_H
+#define BATCHCONVERTER_H
+
+// 无界面批量导出：htmleditor --export [-o 输出目录] [-j 线程数] a.json b.json ...
+// 不创建窗口和图形场景，各文件在线程池中并行转换，输出与编辑器中
+// 导入同一文件后 generateHTML 的结果一致，结束时打印每个文件的耗时
+namespace BatchConverter {
+
+bool isRequested(int argc, char *argv[]);
+int run(int argc, char *argv[]);
+
+}
+
+#endif // BATCHCONVERTER_H
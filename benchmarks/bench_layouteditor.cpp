@@ -0,0 +1,244 @@
+#include "layouteditor.h"
+#include "layouteditoritem.h"
+#include "textitem.h"
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <memory>
+
+// 合成场景：每 5 个图形项中 1 个文字项、4 个图片项，随机分布在宽 1920 的页面上，
+// 页面高度随数量增长，保持大致相同的密度。规模由 HTMLEDITOR_BENCH_MAX 限制（默认 100000）
+class LayoutEditorBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void trySnap_data();
+    void trySnap();
+    void generateHTML_data();
+    void generateHTML();
+    void jsonRoundTrip_data();
+    void jsonRoundTrip();
+    void drawBackground_data();
+    void drawBackground();
+    void repaintView_data();
+    void repaintView();
+    void hitTest_data();
+    void hitTest();
+    void mousePress_data();
+    void mousePress();
+
+private:
+    void addSizes();
+    void populate(int count);
+
+    QTemporaryDir dir;
+    QString imagePath;
+    QPixmap pixmap;
+    std::unique_ptr<LayoutEditor> editor;
+    QRectF pageRect;
+};
+
+void LayoutEditorBenchmark::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    QImage image(64, 48, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::darkCyan);
+    imagePath = dir.filePath("tile.png");
+    QVERIFY(image.save(imagePath));
+    pixmap = QPixmap::fromImage(image);
+}
+
+void LayoutEditorBenchmark::init()
+{
+    editor = std::make_unique<LayoutEditor>();
+    editor->resize(1920, 1080);
+    QFETCH(int, count);
+    populate(count);
+}
+
+void LayoutEditorBenchmark::cleanup()
+{
+    editor.reset();
+}
+
+void LayoutEditorBenchmark::addSizes()
+{
+    QTest::addColumn<int>("count");
+    int limit = qEnvironmentVariableIntValue("HTMLEDITOR_BENCH_MAX");
+    if (limit <= 0)
+        limit = 100000;
+    for (int count : { 100, 1000, 10000, 100000 }) {
+        if (count <= limit)
+            QTest::addRow("%d", count) << count;
+    }
+}
+
+void LayoutEditorBenchmark::populate(int count)
+{
+    QGraphicsScene *scene = editor->scene;
+    pageRect = QRectF(0, 0, 1920, qMax(1080, count * 2));
+    scene->setSceneRect(pageRect);
+
+    QRandomGenerator rng(42);  // 固定种子，各版本之间结果可比
+    for (int i = 0; i < count; ++i) {
+        QPointF pos(rng.bounded(1920 - 64), rng.bounded(int(pageRect.height()) - 48));
+        QGraphicsItem *item;
+        if (i % 5 == 0) {
+            auto *text = new TextItem(QString("Text %1").arg(i));
+            item = text;
+        } else {
+            auto *img = new LayoutEditorItem(pixmap, imagePath);
+            img->setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable);
+            item = img;
+        }
+        scene->addItem(item);
+        item->setPos(pos);
+    }
+    editor->flushIndexes();
+}
+
+void LayoutEditorBenchmark::trySnap_data()
+{
+    addSizes();
+}
+
+void LayoutEditorBenchmark::trySnap()
+{
+    QGraphicsItem *moving = editor->scene->items(Qt::AscendingOrder).constFirst();
+    QRandomGenerator rng(7);
+    QVector<QPointF> targets;
+    for (int i = 0; i < 1000; ++i)
+        targets.append(QPointF(rng.bounded(1920), rng.bounded(int(pageRect.height()))));
+
+    QBENCHMARK {
+        for (const QPointF &target : std::as_const(targets))
+            editor->trySnap(moving, target);
+    }
+}
+
+void LayoutEditorBenchmark::generateHTML_data()
+{
+    addSizes();
+}
+
+void LayoutEditorBenchmark::generateHTML()
+{
+    QBENCHMARK {
+        QString html = editor->generateHTML();
+        QVERIFY(!html.isEmpty());
+    }
+}
+
+void LayoutEditorBenchmark::jsonRoundTrip_data()
+{
+    addSizes();
+}
+
+void LayoutEditorBenchmark::jsonRoundTrip()
+{
+    // 保存后重新载入，直到最后一批图形项插入完成（不等待图片解码）
+    QString path = dir.filePath("roundtrip.json");
+    QSignalSpy finished(editor.get(), &LayoutEditor::loadFinished);
+    QBENCHMARK {
+        editor->saveToJson(path);
+        editor->loadFromJson(path);
+        QVERIFY(finished.wait(600000));
+        QCOMPARE(finished.takeFirst().at(0).toBool(), true);
+    }
+}
+
+void LayoutEditorBenchmark::drawBackground_data()
+{
+    addSizes();
+}
+
+void LayoutEditorBenchmark::drawBackground()
+{
+    QImage target(1920, 1080, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&target);
+    QRectF exposed(0, 0, 1920, 1080);
+    QBENCHMARK {
+        editor->drawBackground(&painter, exposed);
+    }
+}
+
+void LayoutEditorBenchmark::repaintView_data()
+{
+    addSizes();
+}
+
+void LayoutEditorBenchmark::repaintView()
+{
+    editor->show();
+    QVERIFY(QTest::qWaitForWindowExposed(editor.get()));
+    QBENCHMARK {
+        editor->viewport()->repaint();  // 同步重绘整个视口
+    }
+}
+
+void LayoutEditorBenchmark::hitTest_data()
+{
+    addSizes();
+}
+
+void LayoutEditorBenchmark::hitTest()
+{
+    QRandomGenerator rng(11);
+    QVector<QPointF> points;
+    for (int i = 0; i < 1000; ++i)
+        points.append(QPointF(rng.bounded(1920), rng.bounded(int(pageRect.height()))));
+
+    QBENCHMARK {
+        for (const QPointF &point : std::as_const(points))
+            editor->hitItem(point);
+    }
+}
+
+void LayoutEditorBenchmark::mousePress_data()
+{
+    addSizes();
+}
+
+void LayoutEditorBenchmark::mousePress()
+{
+    // 完整的点击路径：编辑器的命中测试加上 Qt 的事件分发，点击空白处会开始并结束框选
+    editor->show();
+    QVERIFY(QTest::qWaitForWindowExposed(editor.get()));
+    QRandomGenerator rng(13);
+    QVector<QPoint> points;
+    for (int i = 0; i < 1000; ++i)
+        points.append(QPoint(rng.bounded(editor->viewport()->width()), rng.bounded(editor->viewport()->height())));
+
+    QBENCHMARK {
+        for (const QPoint &point : std::as_const(points)) {
+            QTest::mousePress(editor->viewport(), Qt::LeftButton, Qt::NoModifier, point);
+            QTest::mouseRelease(editor->viewport(), Qt::LeftButton, Qt::NoModifier, point);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    // 未指定输出时使用 CSV，便于脚本按版本汇总比较
+    QStringList args = app.arguments();
+    if (!args.contains("-o"))
+        args << "-o" << "-,csv";
+
+    LayoutEditorBenchmark benchmark;
+    return QTest::qExec(&benchmark, args);
+}
+
+#include "bench_layouteditor.moc"
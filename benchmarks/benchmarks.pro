@@ -0,0 +1,55 @@
+# 编辑器热点路径的基准测试，独立于主程序构建：
+#   qmake benchmarks/benchmarks.pro && make
+#   ./htmleditor_bench                  默认输出 CSV 到标准输出
+#   ./htmleditor_bench -o bench.xml,xml 其他 QtTest 输出格式
+
+QT       += core gui widgets concurrent testlib
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = htmleditor_bench
+INCLUDEPATH += ..
+
+SOURCES += \
+    bench_layouteditor.cpp \
+    ../assetbundle.cpp \
+    ../autosavejournal.cpp \
+    ../binarylayout.cpp \
+    ../carouselclock.cpp \
+    ../carouselitem.cpp \
+    ../framediagnostics.cpp \
+    ../htmlexporter.cpp \
+    ../imageloader.cpp \
+    ../itemindex.cpp \
+    ../layouteditor.cpp \
+    ../layouteditoritem.cpp \
+    ../layoutrecord.cpp \
+    ../pixmapcache.cpp \
+    ../resizehandleitem.cpp \
+    ../responsiveimages.cpp \
+    ../snapindex.cpp \
+    ../textitem.cpp \
+    ../tracer.cpp \
+    ../undohistory.cpp
+
+HEADERS += \
+    ../assetbundle.h \
+    ../autosavejournal.h \
+    ../binarylayout.h \
+    ../carouselclock.h \
+    ../carouselitem.h \
+    ../framediagnostics.h \
+    ../htmlexporter.h \
+    ../imageloader.h \
+    ../itemindex.h \
+    ../layouteditor.h \
+    ../layouteditoritem.h \
+    ../layoutrecord.h \
+    ../pixmapcache.h \
+    ../resizehandleitem.h \
+    ../responsiveimages.h \
+    ../snapindex.h \
+    ../textitem.h \
+    ../tracer.h \
+    ../undohistory.h
@@ -0,0 +1,241 @@
+#include "binarylayout.h"
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+
+namespace BinaryLayout {
+
+namespace {
+const char Magic[4] = { 'H', 'L', 'Y', 'T' };
+const quint32 Version = 1;
+const quint32 NoString = 0xffffffff;
+
+// 文件头（64 字节）
+//   0  magic "HLYT"      4  u32 版本
+//   8  u32 图形项数      12 u32 字符串数     16 u32 图片数    20 保留
+//   24 u64 图形项表偏移  32 u64 字符串表偏移 40 u64 图片表偏移 48 u64 标记 56.. 保留
+const int HeaderSize = 64;
+
+// 图形项（56 字节）
+//   0  u8 类型  1 u8 标志（bit0 加粗）  2 保留  4 i32 字号
+//   8  f64 x   16 f64 y   24 f64 宽   32 f64 高
+//   40 u32 内容字符串  44 u32 字体字符串  48 u32 颜色 ARGB  52 i32 图片下标
+const int ItemSize = 56;
+const int StringEntrySize = 16;  // u64 偏移, u32 长度, 保留
+const int BlobEntrySize = 40;    // u64 偏移, u64 长度, 20 字节 SHA-1, 保留
+const int BlobKeySize = 20;
+
+template <typename T>
+void put(QByteArray &out, qsizetype at, T value)
+{
+    qToLittleEndian<T>(value, out.data() + at);
+}
+
+template <typename T>
+T get(const uchar *at)
+{
+    return qFromLittleEndian<T>(at);
+}
+}
+
+quint32 Writer::addString(const QString &text)
+{
+    auto it = stringIndex.constFind(text);
+    if (it != stringIndex.cend())
+        return it.value();
+    quint32 index = strings.size();
+    strings.append(text.toUtf8());
+    stringIndex.insert(text, index);
+    return index;
+}
+
+int Writer::addBlob(const QByteArray &data)
+{
+    QByteArray key = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    auto it = blobIndex.constFind(key);
+    if (it != blobIndex.cend())
+        return it.value();
+    int index = blobs.size();
+    blobs.append(data);
+    blobKeys.append(key);
+    blobIndex.insert(key, index);
+    return index;
+}
+
+void Writer::addItem(const Item &item)
+{
+    qsizetype at = itemTable.size();
+    itemTable.append(ItemSize, '\0');
+
+    put<quint8>(itemTable, at, item.type);
+    put<quint8>(itemTable, at + 1, item.bold ? 1 : 0);
+    put<qint32>(itemTable, at + 4, item.fontSize);
+    put<double>(itemTable, at + 8, item.pos.x());
+    put<double>(itemTable, at + 16, item.pos.y());
+    put<double>(itemTable, at + 24, item.size.width());
+    put<double>(itemTable, at + 32, item.size.height());
+    put<quint32>(itemTable, at + 40, addString(item.content));
+    put<quint32>(itemTable, at + 44, item.type == Item::Text ? addString(item.fontFamily) : NoString);
+    put<quint32>(itemTable, at + 48, item.color);
+    put<qint32>(itemTable, at + 52, item.blob);
+}
+
+void Writer::setTag(quint64 tag)
+{
+    fileTag = tag;
+}
+
+bool Writer::save(const QString &filePath)
+{
+    quint64 itemTableOffset = HeaderSize;
+    quint64 stringTableOffset = itemTableOffset + itemTable.size();
+    quint64 blobTableOffset = stringTableOffset + quint64(strings.size()) * StringEntrySize;
+    quint64 dataOffset = blobTableOffset + quint64(blobs.size()) * BlobEntrySize;
+
+    QByteArray header(HeaderSize, '\0');
+    memcpy(header.data(), Magic, sizeof(Magic));
+    put<quint32>(header, 4, Version);
+    put<quint32>(header, 8, quint32(itemTable.size() / ItemSize));
+    put<quint32>(header, 12, quint32(strings.size()));
+    put<quint32>(header, 16, quint32(blobs.size()));
+    put<quint64>(header, 24, itemTableOffset);
+    put<quint64>(header, 32, stringTableOffset);
+    put<quint64>(header, 40, blobTableOffset);
+    put<quint64>(header, 48, fileTag);
+
+    QByteArray stringTable(strings.size() * StringEntrySize, '\0');
+    quint64 offset = dataOffset;
+    for (int i = 0; i < strings.size(); ++i) {
+        put<quint64>(stringTable, i * StringEntrySize, offset);
+        put<quint32>(stringTable, i * StringEntrySize + 8, quint32(strings[i].size()));
+        offset += strings[i].size();
+    }
+
+    QByteArray blobTable(blobs.size() * BlobEntrySize, '\0');
+    for (int i = 0; i < blobs.size(); ++i) {
+        put<quint64>(blobTable, i * BlobEntrySize, offset);
+        put<quint64>(blobTable, i * BlobEntrySize + 8, quint64(blobs[i].size()));
+        memcpy(blobTable.data() + i * BlobEntrySize + 16, blobKeys[i].constData(), BlobKeySize);
+        offset += blobs[i].size();
+    }
+
+    // 写完整个文件后才替换旧文件，中途失败不会破坏已有文件
+    QSaveFile out(filePath);
+    if (!out.open(QIODevice::WriteOnly))
+        return false;
+    bool ok = out.write(header) == header.size()
+              && out.write(itemTable) == itemTable.size()
+              && out.write(stringTable) == stringTable.size()
+              && out.write(blobTable) == blobTable.size();
+    for (int i = 0; ok && i < strings.size(); ++i)
+        ok = out.write(strings[i]) == strings[i].size();
+    for (int i = 0; ok && i < blobs.size(); ++i)
+        ok = out.write(blobs[i]) == blobs[i].size();
+    if (!ok)
+        out.cancelWriting();
+    return out.commit();
+}
+
+bool Reader::open(const QString &filePath)
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    size = file.size();
+    if (size < quint64(HeaderSize))
+        return false;
+    data = file.map(0, file.size());
+    if (!data)
+        return false;
+
+    if (memcmp(data, Magic, sizeof(Magic)) != 0 || get<quint32>(data + 4) != Version)
+        return false;
+    items = get<quint32>(data + 8);
+    stringCount = get<quint32>(data + 12);
+    blobCount = get<quint32>(data + 16);
+    itemTable = get<quint64>(data + 24);
+    stringTable = get<quint64>(data + 32);
+    blobTable = get<quint64>(data + 40);
+    fileTag = get<quint64>(data + 48);
+
+    // 各表必须完整落在文件内，之后的读取只需检查字符串和图片数据
+    return inRange(itemTable, quint64(items) * ItemSize)
+           && inRange(stringTable, quint64(stringCount) * StringEntrySize)
+           && inRange(blobTable, quint64(blobCount) * BlobEntrySize);
+}
+
+QString Reader::fileName() const
+{
+    return file.fileName();
+}
+
+bool Reader::inRange(quint64 offset, quint64 length) const
+{
+    return offset <= size && length <= size - offset;
+}
+
+int Reader::itemCount() const
+{
+    return int(items);
+}
+
+quint64 Reader::tag() const
+{
+    return fileTag;
+}
+
+QString Reader::string(quint32 index) const
+{
+    if (index >= stringCount)
+        return QString();
+    const uchar *entry = data + stringTable + quint64(index) * StringEntrySize;
+    quint64 offset = get<quint64>(entry);
+    quint32 length = get<quint32>(entry + 8);
+    if (!inRange(offset, length))
+        return QString();
+    return QString::fromUtf8(reinterpret_cast<const char *>(data + offset), length);
+}
+
+Item Reader::item(int index) const
+{
+    Item item;
+    if (index < 0 || quint32(index) >= items)
+        return item;
+
+    const uchar *record = data + itemTable + quint64(index) * ItemSize;
+    item.type = get<quint8>(record) == Item::Text ? Item::Text : Item::Image;
+    item.bold = get<quint8>(record + 1) & 1;
+    item.fontSize = get<qint32>(record + 4);
+    item.pos = QPointF(get<double>(record + 8), get<double>(record + 16));
+    item.size = QSizeF(get<double>(record + 24), get<double>(record + 32));
+    item.content = string(get<quint32>(record + 40));
+    item.fontFamily = string(get<quint32>(record + 44));
+    item.hasColor = true;
+    item.color = get<quint32>(record + 48);
+    qint32 blob = get<qint32>(record + 52);
+    item.blob = blob >= 0 && quint32(blob) < blobCount ? blob : -1;
+    return item;
+}
+
+QByteArray Reader::blob(int index) const
+{
+    if (index < 0 || quint32(index) >= blobCount)
+        return QByteArray();
+    const uchar *entry = data + blobTable + quint64(index) * BlobEntrySize;
+    quint64 offset = get<quint64>(entry);
+    quint64 length = get<quint64>(entry + 8);
+    if (!inRange(offset, length))
+        return QByteArray();
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(data + offset), qsizetype(length));
+}
+
+QByteArray Reader::blobKey(int index) const
+{
+    if (index < 0 || quint32(index) >= blobCount)
+        return QByteArray();
+    const uchar *entry = data + blobTable + quint64(index) * BlobEntrySize;
+    return QByteArray(reinterpret_cast<const char *>(entry + 16), BlobKeySize);
+}
+
+}
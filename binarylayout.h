@@ -0,0 +1,73 @@
+#ifndef BINARYLAYOUT_H
+#define BINARYLAYOUT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "layoutrecord.h"
+
+// 二进制布局文件（.hlb），全部为小端序：
+//   文件头        64 字节，见 binarylayout.cpp
+//   图形项表      每项固定 56 字节，可按下标直接定位
+//   字符串表      每项 16 字节（偏移、长度），内容为 UTF-8，相同字符串只存一份
+//   图片表        每项 40 字节（偏移、长度、SHA-1），内容为原始图片文件，可选
+// 读取时整个文件做内存映射，几何信息立即可用，图片数据用到时才访问
+namespace BinaryLayout {
+
+using Item = LayoutRecord;
+
+class Writer
+{
+public:
+    int addBlob(const QByteArray &data);  // 内容相同的图片只保存一次
+    void addItem(const Item &item);
+    void setTag(quint64 tag);  // 调用方自定义的标记，如自动保存的快照代号
+    bool save(const QString &filePath);
+
+private:
+    quint32 addString(const QString &text);
+
+    quint64 fileTag = 0;
+    QByteArray itemTable;
+    QVector<QByteArray> strings;
+    QHash<QString, quint32> stringIndex;
+    QVector<QByteArray> blobs;
+    QVector<QByteArray> blobKeys;
+    QHash<QByteArray, int> blobIndex;
+};
+
+class Reader
+{
+public:
+    bool open(const QString &filePath);
+    QString fileName() const;
+
+    int itemCount() const;
+    Item item(int index) const;
+    quint64 tag() const;
+
+    // 返回指向映射内存的数据，不复制；Reader 析构后失效
+    QByteArray blob(int index) const;
+    QByteArray blobKey(int index) const;
+
+private:
+    QString string(quint32 index) const;
+    bool inRange(quint64 offset, quint64 size) const;
+
+    QFile file;
+    const uchar *data = nullptr;
+    quint64 size = 0;
+    quint32 items = 0;
+    quint32 stringCount = 0;
+    quint32 blobCount = 0;
+    quint64 fileTag = 0;
+    quint64 itemTable = 0;
+    quint64 stringTable = 0;
+    quint64 blobTable = 0;
+};
+
+}
+
+#endif // BINARYLAYOUT_H
@@ -0,0 +1,68 @@
+#include "carouselclock.h"
+#include "carouselitem.h"
+#include <QEvent>
+#include <QGraphicsView>
+
+CarouselClock::CarouselClock(QGraphicsView *view)
+    : QObject(view), view(view)
+{
+    timer.setInterval(3000);
+    timer.setTimerType(Qt::CoarseTimer);  // 允许系统合并唤醒
+    connect(&timer, &QTimer::timeout, this, &CarouselClock::tick);
+
+    viewShown = view->isVisible();
+    view->installEventFilter(this);
+}
+
+void CarouselClock::add(CarouselItem *item)
+{
+    carousels.insert(item);
+    updateRunning();
+}
+
+void CarouselClock::remove(CarouselItem *item)
+{
+    carousels.remove(item);
+    updateRunning();
+}
+
+void CarouselClock::setInterval(int msec)
+{
+    timer.setInterval(msec);
+}
+
+bool CarouselClock::isRunning() const
+{
+    return timer.isActive();
+}
+
+bool CarouselClock::eventFilter(QObject *watched, QEvent *event)
+{
+    // 窗口最小化时视图同样会收到（自发的）隐藏事件
+    if (watched == view && (event->type() == QEvent::Show || event->type() == QEvent::Hide)) {
+        viewShown = event->type() == QEvent::Show;
+        updateRunning();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void CarouselClock::updateRunning()
+{
+    bool shouldRun = viewShown && !carousels.isEmpty();
+    if (shouldRun && !timer.isActive())
+        timer.start();
+    else if (!shouldRun && timer.isActive())
+        timer.stop();
+}
+
+void CarouselClock::tick()
+{
+    QRectF visible = view->mapToScene(view->viewport()->rect()).boundingRect();
+    for (CarouselItem *item : std::as_const(carousels)) {
+        if (item->isPaused() || !item->isVisible())
+            continue;
+        if (!item->sceneBoundingRect().intersects(visible))
+            continue;  // 不在视口内的轮播图不推进，也不触发重绘
+        item->nextSlide();
+    }
+}
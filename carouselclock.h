@@ -0,0 +1,39 @@
+#ifndef CAROUSELCLOCK_H
+#define CAROUSELCLOCK_H
+
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+
+class QGraphicsView;
+class CarouselItem;
+
+// 场景级的轮播时钟：所有轮播图共用一个定时器，只推进视口内可见的轮播图，
+// 视图隐藏（窗口最小化、关闭）或没有轮播图时定时器完全停止
+class CarouselClock : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CarouselClock(QGraphicsView *view);
+
+    void add(CarouselItem *item);
+    void remove(CarouselItem *item);
+    void setInterval(int msec);
+    bool isRunning() const;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void tick();
+
+private:
+    void updateRunning();
+
+    QGraphicsView *view;
+    QTimer timer;
+    QSet<CarouselItem *> carousels;
+    bool viewShown = false;
+};
+
+#endif // CAROUSELCLOCK_H
@@ -1,16 +1,54 @@
 #include "carouselitem.h"
+#include "imageloader.h"
+#include "carouselclock.h"
+#include "layouteditor.h"
 #include <QPainter>
 #include <QGraphicsSceneMouseEvent>
 
 CarouselItem::CarouselItem(const QStringList &imagePaths, QGraphicsItem *parent)
     : QGraphicsObject(parent), images(imagePaths)
 {
-    setFlags(ItemIsMovable | ItemIsSelectable | ItemSendsScenePositionChanges);
+    setFlags(ItemIsMovable | ItemIsSelectable | ItemSendsScenePositionChanges | ItemSendsGeometryChanges);
     setAcceptHoverEvents(true);
 
-    slideTimer = new QTimer(this);
-    connect(slideTimer, &QTimer::timeout, this, &CarouselItem::nextSlide);
-    slideTimer->start(3000);
+    prefetch(0);
+    prefetch(1);
+}
+
+CarouselItem::~CarouselItem()
+{
+    if (auto *editor = LayoutEditor::fromScene(scene()))
+        editor->carouselClock()->remove(this);
+    for (Slide &slide : ring)
+        ImageLoader::instance()->cancel(&slide);
+}
+
+CarouselItem::Slide *CarouselItem::slideFor(int index)
+{
+    for (Slide &slide : ring) {
+        if (slide.index == index)
+            return &slide;
+    }
+    return nullptr;
+}
+
+void CarouselItem::prefetch(int index)
+{
+    if (images.isEmpty())
+        return;
+    index %= images.size();
+    if (slideFor(index))
+        return;
+
+    // 复用不是当前幻灯片的那个槽位
+    Slide *slot = ring[0].index == currentIndex ? &ring[1] : &ring[0];
+    slot->index = index;
+    slot->pixmap = QPixmap();
+    ImageLoader::instance()->loadScaled(slot, images[index], displaySize, [this, slot](const QPixmap &pixmap) {
+        slot->pixmap = pixmap;
+        if (slot->index == currentIndex)
+            update();
+    });
 }
 
 QRectF CarouselItem::boundingRect() const
@@ -22,8 +60,11 @@ void CarouselItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QW
 {
     if (images.isEmpty()) return;
 
-    QPixmap pix(images[currentIndex]);
-    painter->drawPixmap(boundingRect(), pix, pix.rect());
+    Slide *slide = slideFor(currentIndex);
+    if (slide && !slide->pixmap.isNull())
+        painter->drawPixmap(0, 0, slide->pixmap);  // 已是显示尺寸，直接贴图
+    else
+        painter->fillRect(boundingRect(), QColor(240, 240, 240));  // 解码中
 
     if (isSelected()) {
         painter->setPen(QPen(Qt::blue, 2, Qt::DashLine));
@@ -34,6 +75,8 @@ void CarouselItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QW
 void CarouselItem::addImage(const QString &path)
 {
     images.append(path);
+    prefetch(currentIndex);
+    prefetch(currentIndex + 1);
 }
 
 QStringList CarouselItem::imageSources() const
@@ -45,12 +88,32 @@ void CarouselItem::nextSlide()
 {
     if (images.isEmpty()) return;
     currentIndex = (currentIndex + 1) % images.size();
+    prefetch(currentIndex);      // 正常情况下已预取完成，这里只是兜底
+    prefetch(currentIndex + 1);  // 在后台准备下一张
     update();  // 切换图片后重新绘制
 }
 
+bool CarouselItem::isPaused() const
+{
+    return paused;
+}
+
 void CarouselItem::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *)
 {
     // 双击暂停 / 启动轮播
-    if (slideTimer->isActive()) slideTimer->stop();
-    else slideTimer->start(3000);
+    paused = !paused;
+}
+
+QVariant CarouselItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    // 加入场景时注册到该场景编辑器的时钟，离开时注销
+    if (change == ItemSceneChange) {
+        if (auto *editor = LayoutEditor::fromScene(scene()))
+            editor->carouselClock()->remove(this);
+    } else if (change == ItemSceneHasChanged) {
+        if (auto *editor = LayoutEditor::fromScene(scene()))
+            editor->carouselClock()->add(this);
+    }
+    LayoutEditor::trackItemChange(this, change);
+    return QGraphicsObject::itemChange(change, value);
 }
@@ -3,7 +3,6 @@
 
 #include <QGraphicsObject>
 #include <QPixmap>
-#include <QTimer>
 #include <QStringList>
 
 class CarouselItem : public QGraphicsObject
@@ -12,6 +11,7 @@ class CarouselItem : public QGraphicsObject
 
 public:
     CarouselItem(const QStringList &imagePaths, QGraphicsItem *parent = nullptr);
+    ~CarouselItem();
 
     QRectF boundingRect() const override;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override;
@@ -19,17 +19,29 @@ public:
     void addImage(const QString &path);
     QStringList imageSources() const;
 
+    // 由编辑器的 CarouselClock 统一驱动
+    void nextSlide();
+    bool isPaused() const;
+
 protected:
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
-
-private slots:
-    void nextSlide();
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
 
 private:
+    // 已按显示尺寸解码的幻灯片：当前一张加预取的下一张，重绘时只需贴图
+    struct Slide {
+        int index = -1;
+        QPixmap pixmap;
+    };
+
+    Slide *slideFor(int index);
+    void prefetch(int index);
+
     QStringList images;
     int currentIndex = 0;
-    QTimer *slideTimer;
+    bool paused = false;
     QSize displaySize = QSize(300, 200);  // 默认尺寸
+    Slide ring[2];
 };
 
 #endif // CAROUSELITEM_H
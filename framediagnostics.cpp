@@ -0,0 +1,121 @@
+#include "framediagnostics.h"
+#include <QFont>
+#include <QFontDatabase>
+#include <QPainter>
+#include <QRect>
+
+namespace {
+// 帧时间分布的分段上限（毫秒），最后一段不设上限
+const double BucketLimits[] = { 4, 8, 16.7, 33.3 };
+const int BucketCount = 5;
+const char *const BucketLabels[BucketCount] = { "<4", "<8", "<17", "<33", "33+" };
+
+QString ms(qint64 ns)
+{
+    return QString::number(ns / 1e6, 'f', 1);
+}
+}
+
+FrameDiagnostics::FrameDiagnostics()
+{
+    clock.start();
+}
+
+void FrameDiagnostics::inputReceived()
+{
+    if (inputSince < 0)
+        inputSince = clock.nsecsElapsed();
+}
+
+void FrameDiagnostics::beginFrame()
+{
+    inFrame = true;
+    frameStart = clock.nsecsElapsed();
+    backgroundEnd = frameStart;
+    foregroundStart = frameStart;
+}
+
+void FrameDiagnostics::backgroundDone()
+{
+    if (inFrame)
+        backgroundEnd = clock.nsecsElapsed();
+}
+
+void FrameDiagnostics::foregroundStarted()
+{
+    if (inFrame)
+        foregroundStart = clock.nsecsElapsed();
+}
+
+void FrameDiagnostics::foregroundDone()
+{
+    if (!inFrame)
+        return;
+    qint64 now = clock.nsecsElapsed();
+    backgroundNs = backgroundEnd - frameStart;
+    itemsNs = foregroundStart - backgroundEnd;
+    foregroundNs = now - foregroundStart;
+}
+
+void FrameDiagnostics::endFrame()
+{
+    if (!inFrame)
+        return;
+    inFrame = false;
+    qint64 now = clock.nsecsElapsed();
+    frameNs = now - frameStart;
+    history[historyNext] = frameNs;
+    historyNext = (historyNext + 1) % HistorySize;
+    historyCount = qMin(historyCount + 1, HistorySize);
+
+    if (inputSince >= 0) {
+        latencyNs = now - inputSince;
+        inputSince = -1;
+    }
+}
+
+void FrameDiagnostics::draw(QPainter *painter, const QRect &viewport, int itemCount, int visibleCount) const
+{
+    int buckets[BucketCount] = {};
+    for (int i = 0; i < historyCount; ++i) {
+        double value = history[i] / 1e6;
+        int bucket = 0;
+        while (bucket < BucketCount - 1 && value >= BucketLimits[bucket])
+            ++bucket;
+        ++buckets[bucket];
+    }
+
+    const QRect panel(viewport.left() + 8, viewport.top() + 8, 280, 150);
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing, false);
+    painter->fillRect(panel, QColor(0, 0, 0, 180));
+    painter->setPen(Qt::white);
+    // "monospace" 在 Windows 上不会解析为等宽字体，各列会错位
+    QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    font.setPointSize(9);
+    painter->setFont(font);
+
+    const int lineHeight = 16;
+    int y = panel.top() + 4;
+    auto line = [&](const QString &text) {
+        painter->drawText(QRect(panel.left() + 8, y, panel.width() - 16, lineHeight), Qt::AlignLeft | Qt::AlignVCenter, text);
+        y += lineHeight;
+    };
+    line(QString("输入→画面  %1 ms").arg(latencyNs < 0 ? QString("-") : ms(latencyNs)));
+    line(QString("帧时间      %1 ms").arg(ms(frameNs)));
+    line(QString("  背景 %1 / 图形项 %2 / 前景 %3").arg(ms(backgroundNs), ms(itemsNs), ms(foregroundNs)));
+    line(QString("图形项 %1  可见 %2").arg(itemCount).arg(visibleCount));
+
+    // 最近 HistorySize 帧的帧时间分布
+    const int barAreaTop = y + 4;
+    const int barAreaHeight = panel.bottom() - barAreaTop - lineHeight;
+    const int barWidth = (panel.width() - 16) / BucketCount;
+    for (int i = 0; i < BucketCount; ++i) {
+        int height = historyCount ? barAreaHeight * buckets[i] / historyCount : 0;
+        QRect bar(panel.left() + 8 + i * barWidth, barAreaTop + barAreaHeight - height, barWidth - 4, height);
+        painter->fillRect(bar, i < 3 ? QColor(80, 200, 120) : QColor(230, 90, 70));
+        painter->drawText(QRect(bar.left(), barAreaTop + barAreaHeight, barWidth, lineHeight),
+                          Qt::AlignLeft | Qt::AlignVCenter, BucketLabels[i]);
+    }
+    painter->restore();
+}
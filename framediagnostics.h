@@ -0,0 +1,50 @@
+#ifndef FRAMEDIAGNOSTICS_H
+#define FRAMEDIAGNOSTICS_H
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+class QPainter;
+class QRect;
+
+// 编辑器的诊断浮层：记录每帧背景、图形项、前景三段的绘制耗时，
+// 最近若干帧的帧时间分布，以及从输入事件到画面绘制完成的延迟。
+// 只在浮层打开时创建，关闭时编辑器中只剩空指针判断
+class FrameDiagnostics
+{
+public:
+    FrameDiagnostics();
+
+    void inputReceived();      // 鼠标、键盘事件到达时调用，直到下一帧画完为止只记最早的一次
+    void beginFrame();
+    void backgroundDone();
+    void foregroundStarted();
+    void foregroundDone();
+    void endFrame();
+
+    // 画在视口左上角，painter 需已切换到视口坐标
+    void draw(QPainter *painter, const QRect &viewport, int itemCount, int visibleCount) const;
+
+private:
+    static const int HistorySize = 120;
+
+    QElapsedTimer clock;
+    bool inFrame = false;
+    qint64 frameStart = 0;
+    qint64 backgroundEnd = 0;
+    qint64 foregroundStart = 0;
+    qint64 inputSince = -1;
+
+    // 上一帧的结果
+    qint64 backgroundNs = 0;
+    qint64 itemsNs = 0;
+    qint64 foregroundNs = 0;
+    qint64 frameNs = 0;
+    qint64 latencyNs = -1;
+
+    qint64 history[HistorySize] = {};
+    int historyCount = 0;
+    int historyNext = 0;
+};
+
+#endif // FRAMEDIAGNOSTICS_H
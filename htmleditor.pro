@@ -1,6 +1,6 @@
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 CONFIG += c++17
 
@@ -9,19 +9,51 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    assetbundle.cpp \
+    autosavejournal.cpp \
+    batchconverter.cpp \
+    binarylayout.cpp \
+    carouselclock.cpp \
+    carouselitem.cpp \
+    framediagnostics.cpp \
+    htmlexporter.cpp \
+    imageloader.cpp \
+    itemindex.cpp \
     layouteditor.cpp \
     layouteditoritem.cpp \
+    layoutrecord.cpp \
     main.cpp \
     mainwindow.cpp \
+    pixmapcache.cpp \
     resizehandleitem.cpp \
-    textitem.cpp
+    responsiveimages.cpp \
+    snapindex.cpp \
+    textitem.cpp \
+    tracer.cpp \
+    undohistory.cpp
 
 HEADERS += \
+    assetbundle.h \
+    autosavejournal.h \
+    batchconverter.h \
+    binarylayout.h \
+    carouselclock.h \
+    carouselitem.h \
+    framediagnostics.h \
+    htmlexporter.h \
+    imageloader.h \
+    itemindex.h \
     layouteditor.h \
     layouteditoritem.h \
+    layoutrecord.h \
     mainwindow.h \
+    pixmapcache.h \
     resizehandleitem.h \
-    textitem.h
+    responsiveimages.h \
+    snapindex.h \
+    textitem.h \
+    tracer.h \
+    undohistory.h
 
 
 
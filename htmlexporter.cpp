@@ -0,0 +1,458 @@
+#include "htmlexporter.h"
+#include "layouteditoritem.h"
+#include "textitem.h"
+#include "tracer.h"
+#include <QGraphicsScene>
+#include <QIODevice>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+// 内联样式和样式表共用同一组声明，保证两种输出的显示效果一致
+void appendTextDeclarations(QByteArray &out, const QString &fontFamily, int fontSize, bool bold, const QString &color)
+{
+    out += "font-family:'";
+    out += fontFamily.toUtf8();
+    out += "'; font-size:";
+    out += QByteArray::number(fontSize);
+    out += "pt; font-weight:";
+    out += bold ? "bold" : "normal";
+    out += "; color:";
+    out += color.toLatin1();
+    out += ";";
+}
+
+void appendSizeDeclarations(QByteArray &out, int width, int height)
+{
+    out += "width:";
+    out += QByteArray::number(width);
+    out += "px; height:";
+    out += QByteArray::number(height);
+    out += "px;";
+}
+
+void appendPosition(QByteArray &out, int x, int y, int zIndex)
+{
+    out += "left:";
+    out += QByteArray::number(x);
+    out += "px; top:";
+    out += QByteArray::number(y);
+    out += "px;";
+    if (zIndex >= 0) {
+        out += " z-index:";
+        out += QByteArray::number(zIndex);
+        out += ";";
+    }
+}
+}
+
+HtmlExporter::StyleSheet::TextStyle HtmlExporter::StyleSheet::textStyle(const ItemSnapshot &item)
+{
+    return { item.fontFamily, item.fontSize, item.bold, item.color };
+}
+
+quint64 HtmlExporter::StyleSheet::sizeKey(const ItemSnapshot &item)
+{
+    return (quint64(quint32(item.width)) << 32) | quint32(item.height);
+}
+
+void HtmlExporter::StyleSheet::add(const ItemSnapshot &item)
+{
+    if (item.kind == ItemSnapshot::Text) {
+        TextStyle style = textStyle(item);
+        if (!textClasses.contains(style)) {
+            textClasses.insert(style, textStyles.size());
+            textStyles.append(style);
+        }
+        return;
+    }
+    int &count = sizeCounts[sizeKey(item)];
+    if (count++ == 0)
+        sizeOrder.append(sizeKey(item));
+}
+
+void HtmlExporter::StyleSheet::finalize()
+{
+    // 只出现一次的尺寸单独成类反而更长，仍然内联
+    sizeClasses.clear();
+    for (quint64 key : std::as_const(sizeOrder)) {
+        if (sizeCounts.value(key) > 1)
+            sizeClasses.insert(key, sizeClasses.size());
+    }
+}
+
+void HtmlExporter::StyleSheet::clear()
+{
+    textClasses.clear();
+    textStyles.clear();
+    sizeCounts.clear();
+    sizeOrder.clear();
+    sizeClasses.clear();
+}
+
+void HtmlExporter::StyleSheet::write(QByteArray &out) const
+{
+    if (textStyles.isEmpty() && sizeClasses.isEmpty())
+        return;
+    out += "<style>\n";
+    for (int i = 0; i < textStyles.size(); ++i) {
+        const TextStyle &style = textStyles[i];
+        out += ".t";
+        out += QByteArray::number(i);
+        out += "{position:absolute; ";
+        appendTextDeclarations(out, style.fontFamily, style.fontSize, style.bold, style.color);
+        out += "}\n";
+    }
+    for (quint64 key : std::as_const(sizeOrder)) {
+        auto it = sizeClasses.constFind(key);
+        if (it == sizeClasses.cend())
+            continue;
+        out += ".i";
+        out += QByteArray::number(it.value());
+        out += "{position:absolute; ";
+        appendSizeDeclarations(out, int(quint32(key >> 32)), int(quint32(key)));
+        out += "}\n";
+    }
+    out += "</style>\n";
+}
+
+int HtmlExporter::StyleSheet::textClass(const ItemSnapshot &item) const
+{
+    return textClasses.value(textStyle(item), -1);
+}
+
+int HtmlExporter::StyleSheet::imageClass(const ItemSnapshot &item) const
+{
+    return sizeClasses.value(sizeKey(item), -1);
+}
+
+HtmlExporter::HtmlExporter(const QGraphicsScene *scene)
+    : scene(scene)
+{
+}
+
+void HtmlExporter::setChunkSize(int bytes)
+{
+    chunk = qMax(1024, bytes);
+}
+
+int HtmlExporter::chunkSize() const
+{
+    return chunk;
+}
+
+void HtmlExporter::setParallel(bool enabled)
+{
+    parallel = enabled;
+}
+
+void HtmlExporter::setStyleClasses(bool enabled)
+{
+    styleClasses = enabled;
+}
+
+void HtmlExporter::setImageResolver(const ImageResolver &resolver)
+{
+    imageResolver = resolver;
+}
+
+void HtmlExporter::setLoadingHints(int foldY)
+{
+    fold = foldY;
+}
+
+int HtmlExporter::loadingFold() const
+{
+    return fold;
+}
+
+HtmlExporter::FragmentOptions HtmlExporter::fragmentOptions() const
+{
+    FragmentOptions options;
+    options.styles = styleClasses ? &styles : nullptr;
+    options.images = imageResolver ? &imageResolver : nullptr;
+    options.fold = fold;
+    return options;
+}
+
+QVector<int> HtmlExporter::positionOrder(const QVector<QPoint> &positions)
+{
+    // 文档顺序即浏览器发现资源的顺序，首屏内容排在前面
+    QVector<int> order(positions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&positions](int a, int b) {
+        const QPoint &p = positions[a];
+        const QPoint &q = positions[b];
+        return p.y() != q.y() ? p.y() < q.y() : p.x() < q.x();
+    });
+    return order;
+}
+
+bool HtmlExporter::flush()
+{
+    if (buffer.isEmpty())
+        return true;
+    bool ok = device->write(buffer) == buffer.size();
+    buffer.resize(0);  // 保留已分配的容量，下一块直接复用
+    return ok;
+}
+
+void HtmlExporter::begin(QIODevice *device)
+{
+    this->device = device;
+    buffer.resize(0);
+    buffer.reserve(chunk + 1024);
+
+    buffer += "<!DOCTYPE html>\n<html>\n<head><meta charset=\"utf-8\">\n";
+    if (styleClasses)
+        styles.write(buffer);
+    buffer += "</head>\n<body>\n";
+}
+
+bool HtmlExporter::finish(bool ok)
+{
+    if (ok) {
+        buffer += "</body>\n</html>\n";
+        ok = flush();
+    }
+    device = nullptr;
+    return ok;
+}
+
+bool HtmlExporter::exportTo(QIODevice *device)
+{
+    TraceSpan span("export html", "export");
+    const QList<QGraphicsItem *> items = scene->items();
+    const int count = items.size();
+    styles.clear();
+    QVector<QPoint> positions;
+    if (fold >= 0)
+        positions.resize(count);
+    if (styleClasses || fold >= 0) {
+        // 样式表写在 <head> 里，先统计一遍，顺带记录排序用的位置；只读取样式，不读取文字内容
+        ItemSnapshot data;
+        for (int i = 0; i < count; ++i) {
+            if (!snapshot(items[i], &data, false))
+                continue;
+            if (styleClasses)
+                styles.add(data);
+            if (fold >= 0)
+                positions[i] = QPoint(data.x, data.y);
+        }
+        if (styleClasses)
+            styles.finalize();
+    }
+    // 按位置排列时只排下标，快照仍在格式化时逐块读取
+    const QVector<int> order = fold >= 0 ? positionOrder(positions) : QVector<int>();
+    begin(device);
+    bool ok = exportItems(count, [&items, &order, count](int index, ItemSnapshot *out) {
+        // 原来越靠前的图形项越在上层，重新排列后用 z-index 保留堆叠关系
+        int source = order.isEmpty() ? index : order[index];
+        if (!snapshot(items[source], out))
+            return false;
+        out->zIndex = order.isEmpty() ? -1 : count - source;
+        return true;
+    });
+    return finish(ok);
+}
+
+bool HtmlExporter::exportTo(QIODevice *device, const QVector<ItemSnapshot> &items)
+{
+    TraceSpan span("export html", "export");
+    const int count = items.size();
+    styles.clear();
+    if (styleClasses) {
+        for (const ItemSnapshot &item : items)
+            styles.add(item);
+        styles.finalize();
+    }
+    QVector<int> order;
+    if (fold >= 0) {
+        QVector<QPoint> positions;
+        positions.reserve(count);
+        for (const ItemSnapshot &item : items)
+            positions.append(QPoint(item.x, item.y));
+        order = positionOrder(positions);
+    }
+    begin(device);
+    bool ok = exportItems(count, [&items, &order, count](int index, ItemSnapshot *out) {
+        int source = order.isEmpty() ? index : order[index];
+        *out = items[source];
+        if (!order.isEmpty())
+            out->zIndex = count - source;
+        return true;
+    });
+    return finish(ok);
+}
+
+bool HtmlExporter::exportItems(int count, const SnapshotReader &read)
+{
+    return parallel && count >= MinParallelItems && QThread::idealThreadCount() > 1
+               ? exportParallel(count, read)
+               : exportSerial(count, read);
+}
+
+bool HtmlExporter::exportSerial(int count, const SnapshotReader &read)
+{
+    const FragmentOptions options = fragmentOptions();
+    ItemSnapshot data;
+    for (int i = 0; i < count; ++i) {
+        if (read(i, &data))
+            appendFragment(buffer, data, options);
+
+        if (buffer.size() >= chunk && !flush())
+            return false;
+    }
+    return true;
+}
+
+bool HtmlExporter::exportParallel(int count, const SnapshotReader &read)
+{
+    struct Block {
+        QVector<ItemSnapshot> items;
+        QByteArray html;
+    };
+
+    // 每轮处理若干块，写出后复用，内存占用只与一轮的大小有关
+    const int blocksPerRound = QThread::idealThreadCount() * 2;
+    QVector<Block> blocks(blocksPerRound);
+    const FragmentOptions options = fragmentOptions();
+
+    int next = 0;
+    while (next < count) {
+        // 快照在调用线程中读取，图形项不是线程安全的
+        int used = 0;
+        for (; used < blocksPerRound && next < count; ++used) {
+            Block &block = blocks[used];
+            block.items.resize(0);
+            block.html.resize(0);
+            int end = qMin(count, next + BlockSize);
+            ItemSnapshot data;
+            for (; next < end; ++next) {
+                if (read(next, &data))
+                    block.items.append(data);
+            }
+        }
+
+        QtConcurrent::blockingMap(blocks.begin(), blocks.begin() + used, [&options](Block &block) {
+            for (const ItemSnapshot &data : std::as_const(block.items))
+                appendFragment(block.html, data, options);
+        });
+
+        // 按输出顺序拼接，与串行导出完全一致
+        for (int i = 0; i < used; ++i) {
+            buffer += blocks[i].html;
+            if (buffer.size() >= chunk && !flush())
+                return false;
+        }
+    }
+    return true;
+}
+
+bool HtmlExporter::snapshot(const QGraphicsItem *item, ItemSnapshot *out, bool withContent)
+{
+    if (auto *imgItem = qgraphicsitem_cast<const LayoutEditorItem *>(item)) {
+        QRectF bounds = imgItem->sceneBoundingRect();
+        out->kind = ItemSnapshot::Image;
+        out->x = int(bounds.left());
+        out->y = int(bounds.top());
+        out->width = int(bounds.width());
+        out->height = int(bounds.height());
+        out->content = imgItem->source();
+        return true;
+    }
+    if (auto *textItem = qgraphicsitem_cast<const TextItem *>(item)) {
+        QPointF pos = textItem->scenePos();
+        QFont font = textItem->font();
+        out->kind = ItemSnapshot::Text;
+        out->x = int(pos.x());
+        out->y = int(pos.y());
+        if (withContent)
+            out->content = textItem->toPlainText();
+        out->fontFamily = font.family();
+        out->fontSize = font.pointSize();
+        out->bold = font.bold();
+        out->color = textItem->defaultTextColor().name();  // 输出为 "#RRGGBB"
+        return true;
+    }
+    return false;
+}
+
+void HtmlExporter::appendFragment(QByteArray &out, const ItemSnapshot &item, const FragmentOptions &options)
+{
+    const StyleSheet *styles = options.styles;
+    const ImageResolver *images = options.images;
+    if (item.kind == ItemSnapshot::Image) {
+        ImageRef ref;
+        out += "<img src=\"";
+        if (images && (*images)(item, &ref)) {
+            out += ref.src.toUtf8();
+            if (!ref.srcset.isEmpty()) {
+                out += "\" srcset=\"";
+                out += ref.srcset.toUtf8();
+            }
+            if (!ref.sizes.isEmpty()) {
+                out += "\" sizes=\"";
+                out += ref.sizes.toUtf8();
+            }
+        } else {
+            out += item.content.toUtf8();
+        }
+        int imageClass = styles ? styles->imageClass(item) : -1;
+        if (imageClass >= 0) {
+            out += "\" class=\"i";
+            out += QByteArray::number(imageClass);
+            out += "\" style=\"";
+            appendPosition(out, item.x, item.y, item.zIndex);
+        } else {
+            out += "\" style=\"position:absolute; ";
+            appendPosition(out, item.x, item.y, item.zIndex);
+            out += ' ';
+            appendSizeDeclarations(out, item.width, item.height);
+        }
+        out += '"';
+        if (options.fold >= 0) {
+            // 尺寸属性让浏览器在图片到达前就留出位置，避免布局跳动
+            out += " width=\"";
+            out += QByteArray::number(item.width);
+            out += "\" height=\"";
+            out += QByteArray::number(item.height);
+            out += item.y < options.fold ? "\" loading=\"eager\" fetchpriority=\"high\""
+                                         : "\" loading=\"lazy\" decoding=\"async\"";
+        }
+        out += ">\n";
+        return;
+    }
+
+    int textClass = styles ? styles->textClass(item) : -1;
+    if (textClass >= 0) {
+        out += "<div class=\"t";
+        out += QByteArray::number(textClass);
+        out += "\" style=\"";
+        appendPosition(out, item.x, item.y, item.zIndex);
+    } else {
+        out += "<div style=\"position:absolute; ";
+        appendPosition(out, item.x, item.y, item.zIndex);
+        out += ' ';
+        appendTextDeclarations(out, item.fontFamily, item.fontSize, item.bold, item.color);
+    }
+    out += "\">";
+    out += item.content.toHtmlEscaped().toUtf8();
+    out += "</div>\n";
+}
+
+void HtmlExporter::appendImage(QByteArray &out, const LayoutEditorItem *item)
+{
+    ItemSnapshot data;
+    snapshot(item, &data);
+    appendFragment(out, data);
+}
+
+void HtmlExporter::appendText(QByteArray &out, const TextItem *item)
+{
+    ItemSnapshot data;
+    snapshot(item, &data);
+    appendFragment(out, data);
+}
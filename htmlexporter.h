@@ -0,0 +1,148 @@
+#ifndef HTMLEXPORTER_H
+#define HTMLEXPORTER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QPoint>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+class QIODevice;
+class QGraphicsScene;
+class QGraphicsItem;
+class LayoutEditorItem;
+class TextItem;
+
+// 流式 HTML 导出：各图形项的片段以 UTF-8 写入可复用的缓冲区，
+// 缓冲区满一块后写入设备，峰值内存与页面大小无关。
+// 图形项较多时先在 GUI 线程读取只读快照，再由线程池分块格式化，按堆叠顺序拼接。
+// 默认先统计一遍样式：相同的文字样式、重复出现的图片尺寸在 <head> 中各生成一个类，
+// 各元素只引用类名并内联自己的位置。
+// 设置了首屏分界线时按纵向位置输出（用 z-index 保留原来的堆叠关系），
+// 分界线以上的图片优先加载，以下的延迟加载、异步解码
+class HtmlExporter
+{
+public:
+    // 导出所需的图形项数据，读取后与场景无关，可在工作线程中格式化
+    struct ItemSnapshot {
+        enum Kind { Image, Text };
+        Kind kind = Image;
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+        QString content;     // 图片路径或纯文本
+        QString fontFamily;
+        int fontSize = 0;
+        bool bold = false;
+        QString color;       // "#RRGGBB"
+        int zIndex = -1;     // 按位置重新排列时保留原堆叠顺序，负数不输出
+    };
+
+    // 改写后的图片地址；srcset、sizes 为空时不输出
+    struct ImageRef {
+        QString src;
+        QString srcset;
+        QString sizes;
+    };
+    // 返回 false 时保留原路径。格式化在工作线程中进行，实现必须只读、线程安全
+    using ImageResolver = std::function<bool(const ItemSnapshot &item, ImageRef *ref)>;
+
+    // 导出共用的样式表，统计完成后只读，可被多个工作线程同时查询
+    class StyleSheet
+    {
+    public:
+        void add(const ItemSnapshot &item);
+        void finalize();  // 统计完成后为出现多次的图片尺寸编号
+        void clear();
+        void write(QByteArray &out) const;
+        int textClass(const ItemSnapshot &item) const;   // 没有对应的类时为 -1
+        int imageClass(const ItemSnapshot &item) const;
+
+    private:
+        struct TextStyle {
+            QString fontFamily;
+            int fontSize;
+            bool bold;
+            QString color;
+
+            friend bool operator==(const TextStyle &a, const TextStyle &b)
+            {
+                return a.fontSize == b.fontSize && a.bold == b.bold
+                       && a.fontFamily == b.fontFamily && a.color == b.color;
+            }
+            friend size_t qHash(const TextStyle &style, size_t seed = 0)
+            {
+                return qHashMulti(seed, style.fontFamily, style.fontSize, style.bold, style.color);
+            }
+        };
+        static TextStyle textStyle(const ItemSnapshot &item);
+        static quint64 sizeKey(const ItemSnapshot &item);
+
+        QHash<TextStyle, int> textClasses;
+        QVector<TextStyle> textStyles;     // 按首次出现的顺序，输出稳定
+        QHash<quint64, int> sizeCounts;
+        QVector<quint64> sizeOrder;
+        QHash<quint64, int> sizeClasses;
+    };
+
+    // 格式化单个片段所需的导出设置，在工作线程中只读
+    struct FragmentOptions {
+        const StyleSheet *styles = nullptr;     // 为空时内联完整样式
+        const ImageResolver *images = nullptr;  // 为空时使用原图片路径
+        int fold = -1;                          // 首屏分界线的 y 坐标，负数不输出加载提示
+    };
+
+    explicit HtmlExporter(const QGraphicsScene *scene = nullptr);
+
+    bool exportTo(QIODevice *device);
+    // 直接导出已按堆叠顺序（从上到下）排列的快照，不需要场景，可在工作线程中调用
+    bool exportTo(QIODevice *device, const QVector<ItemSnapshot> &items);
+
+    void setChunkSize(int bytes);
+    int chunkSize() const;
+    void setParallel(bool enabled);  // 默认开启，图形项较少时自动串行
+    void setStyleClasses(bool enabled);  // 默认开启；关闭时每个元素内联完整样式
+    void setImageResolver(const ImageResolver &resolver);
+    // foldY 以上的图片 eager/high，以下的 lazy/async，并按纵向位置排列元素；负数关闭（默认）
+    void setLoadingHints(int foldY);
+    int loadingFold() const;
+
+    // withContent 为 false 时不读取文字内容，只用于统计样式
+    static bool snapshot(const QGraphicsItem *item, ItemSnapshot *out, bool withContent = true);
+    static void appendFragment(QByteArray &out, const ItemSnapshot &item,
+                               const FragmentOptions &options = FragmentOptions());
+
+    // 单个图形项的 HTML 片段，追加到 out 末尾
+    static void appendImage(QByteArray &out, const LayoutEditorItem *item);
+    static void appendText(QByteArray &out, const TextItem *item);
+
+private:
+    void begin(QIODevice *device);
+    bool finish(bool ok);
+    bool flush();
+    // 按输出顺序读取第 index 个快照，返回 false 表示跳过；只在调用 exportTo 的线程中调用
+    using SnapshotReader = std::function<bool(int index, ItemSnapshot *out)>;
+    bool exportItems(int count, const SnapshotReader &read);
+    bool exportSerial(int count, const SnapshotReader &read);
+    bool exportParallel(int count, const SnapshotReader &read);
+    FragmentOptions fragmentOptions() const;
+    // 按 (y, x) 排列的下标，位置相同时保持原顺序
+    static QVector<int> positionOrder(const QVector<QPoint> &positions);
+
+    static const int BlockSize = 1024;          // 每个任务格式化的图形项数量
+    static const int MinParallelItems = 4096;
+
+    const QGraphicsScene *scene;
+    QIODevice *device = nullptr;
+    QByteArray buffer;
+    int chunk = 64 * 1024;
+    bool parallel = true;
+    bool styleClasses = true;
+    StyleSheet styles;
+    ImageResolver imageResolver;
+    int fold = -1;
+};
+
+#endif // HTMLEXPORTER_H
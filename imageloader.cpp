@@ -0,0 +1,209 @@
+#include "imageloader.h"
+#include "pixmapcache.h"
+#include "tracer.h"
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QImageReader>
+#include <QPromise>
+#include <QtConcurrent>
+
+namespace {
+void decodeImage(QPromise<ImageLoader::Result> &promise, const QString &path)
+{
+    TraceSpan span("decode image", "image");
+    if (promise.isCanceled())
+        return;  // 排队期间已被取消，不再读盘
+
+    PixmapCache *cache = PixmapCache::instance();
+    ImageLoader::Result result;
+    result.identity = PixmapCache::identityKey(QFileInfo(path));
+    result.contentKey = cache->contentKeyFor(result.identity);
+
+    if (result.contentKey.isEmpty() || !cache->isResident(result.contentKey)) {
+        QFile file(path);
+        QByteArray data;
+        if (file.open(QIODevice::ReadOnly))
+            data = file.readAll();
+        result.contentKey = PixmapCache::contentKey(data);
+
+        // 不同路径下的相同文件同样命中缓存
+        if (!cache->isResident(result.contentKey) && !promise.isCanceled()) {
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::ReadOnly);
+            QImageReader reader(&buffer);
+            result.image = reader.read();
+            result.decoded = true;
+        }
+    }
+
+    if (!promise.isCanceled())
+        promise.addResult(result);
+}
+
+// 内嵌在项目文件中的图片，数据直接来自内存映射，keepAlive 保证映射在解码期间有效
+void decodeEncoded(QPromise<ImageLoader::Result> &promise, QByteArray data, const QByteArray &contentKey,
+                   const std::shared_ptr<const void> &keepAlive)
+{
+    TraceSpan span("decode embedded image", "image");
+    Q_UNUSED(keepAlive);
+    if (promise.isCanceled())
+        return;
+
+    ImageLoader::Result result;
+    result.identity = "embedded:" + QString::fromLatin1(contentKey.toHex());
+    result.contentKey = contentKey;
+    if (!PixmapCache::instance()->isResident(contentKey)) {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer);
+        result.image = reader.read();
+        result.decoded = true;
+    }
+
+    if (!promise.isCanceled())
+        promise.addResult(result);
+}
+
+// 直接按目标尺寸解码（JPEG 等格式可在解码阶段缩小），结果不进入共享缓存
+void decodeScaled(QPromise<ImageLoader::Result> &promise, const QString &path, const QSize &size)
+{
+    TraceSpan span("decode scaled image", "image");
+    if (promise.isCanceled())
+        return;
+
+    ImageLoader::Result result;
+    QImageReader reader(path);
+    reader.setScaledSize(size);
+    result.image = reader.read();
+    result.decoded = true;
+
+    if (!promise.isCanceled())
+        promise.addResult(result);
+}
+
+void scaleImage(QPromise<ImageLoader::Result> &promise, const QImage &image, const QSize &size)
+{
+    TraceSpan span("scale image", "resize");
+    if (promise.isCanceled())
+        return;
+
+    ImageLoader::Result result;
+    result.image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    result.decoded = true;
+
+    if (!promise.isCanceled())
+        promise.addResult(result);
+}
+}
+
+ImageLoader::ImageLoader(QObject *parent)
+    : QObject(parent)
+{
+    pool.setObjectName("ImageLoader");
+    // 缓存是静态对象，需在 QGuiApplication 析构前释放其中的 QPixmap
+    if (parent)
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, []() {
+            PixmapCache::instance()->clear();
+        });
+}
+
+ImageLoader *ImageLoader::instance()
+{
+    static ImageLoader *loader = new ImageLoader(QCoreApplication::instance());
+    return loader;
+}
+
+void ImageLoader::load(const void *owner, const QString &path, Callback done)
+{
+    cancel(owner);
+    watchCached(owner, QtConcurrent::run(&pool, decodeImage, path), done, [this, owner, path, done]() {
+        load(owner, path, done);
+    });
+}
+
+void ImageLoader::loadEncoded(const void *owner, const QByteArray &data, const QByteArray &contentKey,
+                              const std::shared_ptr<const void> &keepAlive, Callback done)
+{
+    cancel(owner);
+    watchCached(owner, QtConcurrent::run(&pool, decodeEncoded, data, contentKey, keepAlive), done,
+                [this, owner, data, contentKey, keepAlive, done]() {
+        loadEncoded(owner, data, contentKey, keepAlive, done);
+    });
+}
+
+void ImageLoader::watchCached(const void *owner, const QFuture<Result> &future, Callback done,
+                              std::function<void()> retry)
+{
+    auto *watcher = new QFutureWatcher<Result>(this);
+    pending.insert(owner, watcher);
+    connect(watcher, &QFutureWatcher<Result>::finished, this, [this, owner, watcher, done, retry]() {
+        pending.remove(owner);
+        watcher->deleteLater();
+        QFuture<Result> future = watcher->future();
+        if (future.isCanceled() || future.resultCount() == 0)
+            return;
+
+        Result result = future.result();
+        PixmapCache *cache = PixmapCache::instance();
+        if (result.decoded) {
+            done(result.image.isNull() ? QPixmap()
+                                       : cache->insert(result.identity, result.contentKey, result.image));
+            return;
+        }
+        QPixmap pixmap = cache->find(result.identity, result.contentKey);
+        if (pixmap.isNull()) {
+            // 工作线程检查之后又被淘汰，重新解码
+            cache->forget(result.identity);
+            retry();
+            return;
+        }
+        done(pixmap);
+    });
+    watcher->setFuture(future);
+}
+
+void ImageLoader::loadScaled(const void *owner, const QString &path, const QSize &size, Callback done)
+{
+    cancel(owner);
+    watchPixmap(owner, QtConcurrent::run(&pool, decodeScaled, path, size), done);
+}
+
+void ImageLoader::scale(const void *owner, const QImage &image, const QSize &size, Callback done)
+{
+    cancel(owner);
+    watchPixmap(owner, QtConcurrent::run(&pool, scaleImage, image, size), done);
+}
+
+void ImageLoader::watchPixmap(const void *owner, const QFuture<Result> &future, Callback done)
+{
+    auto *watcher = new QFutureWatcher<Result>(this);
+    pending.insert(owner, watcher);
+    connect(watcher, &QFutureWatcher<Result>::finished, this, [this, owner, watcher, done]() {
+        pending.remove(owner);
+        watcher->deleteLater();
+        QFuture<Result> future = watcher->future();
+        if (future.isCanceled() || future.resultCount() == 0)
+            return;
+        done(QPixmap::fromImage(future.result().image));
+    });
+    watcher->setFuture(future);
+}
+
+void ImageLoader::cancel(const void *owner)
+{
+    QFutureWatcher<Result> *watcher = pending.take(owner);
+    if (!watcher)
+        return;
+    // 断开回调后再取消，已在解码中的任务结束后结果直接丢弃
+    watcher->disconnect(this);
+    watcher->cancel();
+    watcher->deleteLater();
+}
+
+int ImageLoader::pendingCount() const
+{
+    return pending.size();
+}
@@ -0,0 +1,53 @@
+#ifndef IMAGELOADER_H
+#define IMAGELOADER_H
+
+#include <QObject>
+#include <QHash>
+#include <QPixmap>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
+
+template <typename T> class QFutureWatcher;
+template <typename T> class QFuture;
+
+// 后台图片解码：在工作线程中用 QImageReader 读取，完成后在 GUI 线程回调。
+// 解码结果放入 PixmapCache，相同内容的图片直接共享缓存中的原图。
+// 每个请求方（一般是图形项）同时只保留一个请求，图形项删除时应调用 cancel
+class ImageLoader : public QObject
+{
+    Q_OBJECT
+public:
+    using Callback = std::function<void(const QPixmap &)>;
+
+    struct Result {
+        QString identity;
+        QByteArray contentKey;
+        QImage image;
+        bool decoded = false;  // false 表示内容已在缓存中，未重新解码
+    };
+
+    static ImageLoader *instance();
+
+    void load(const void *owner, const QString &path, Callback done);
+    // 解码内存中的图片文件数据（如项目文件内嵌的图片），keepAlive 在解码结束前保持数据有效
+    void loadEncoded(const void *owner, const QByteArray &data, const QByteArray &contentKey,
+                     const std::shared_ptr<const void> &keepAlive, Callback done);
+    // 解码并缩放到 size，适合只按固定尺寸显示的场合
+    void loadScaled(const void *owner, const QString &path, const QSize &size, Callback done);
+    // 在工作线程中对已解码的图片做高质量缩放
+    void scale(const void *owner, const QImage &image, const QSize &size, Callback done);
+    void cancel(const void *owner);
+    int pendingCount() const;
+
+private:
+    explicit ImageLoader(QObject *parent = nullptr);
+    void watchPixmap(const void *owner, const QFuture<Result> &future, Callback done);
+    void watchCached(const void *owner, const QFuture<Result> &future, Callback done,
+                     std::function<void()> retry);
+
+    QThreadPool pool;
+    QHash<const void *, QFutureWatcher<Result> *> pending;
+};
+
+#endif // IMAGELOADER_H
@@ -0,0 +1,187 @@
+#include "itemindex.h"
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+// 闭区间相交判断，零尺寸矩形同样有效（QRectF::intersects 会忽略它们）
+bool overlaps(const QRectF &a, const QRectF &b)
+{
+    return a.left() <= b.right() && b.left() <= a.right()
+           && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+QRectF unite(const QRectF &a, const QRectF &b)
+{
+    qreal left = qMin(a.left(), b.left());
+    qreal top = qMin(a.top(), b.top());
+    qreal right = qMax(a.right(), b.right());
+    qreal bottom = qMax(a.bottom(), b.bottom());
+    return QRectF(left, top, right - left, bottom - top);
+}
+}
+
+void ItemIndex::update(QGraphicsItem *item, const QRectF &sceneRect)
+{
+    auto it = records.find(item);
+    if (it == records.end()) {
+        records.insert(item, Record{sceneRect, nextSeq++, false});
+        overflow.insert(item);
+        return;
+    }
+    if (it->rect == sceneRect)
+        return;
+
+    it->rect = sceneRect;
+    if (it->inTree) {
+        // 树中的旧条目作废，新位置先放入溢出表
+        it->inTree = false;
+        ++staleEntries;
+        overflow.insert(item);
+    }
+}
+
+void ItemIndex::remove(QGraphicsItem *item)
+{
+    auto it = records.find(item);
+    if (it == records.end())
+        return;
+    if (it->inTree)
+        ++staleEntries;
+    else
+        overflow.remove(item);
+    records.erase(it);
+}
+
+void ItemIndex::clear()
+{
+    records.clear();
+    entries.clear();
+    levels.clear();
+    overflow.clear();
+    staleEntries = 0;
+    nextSeq = 0;
+}
+
+void ItemIndex::commit()
+{
+    if (records.size() < MinTreeSize) {
+        if (!levels.isEmpty()) {
+            entries.clear();
+            levels.clear();
+            staleEntries = 0;
+            for (auto it = records.begin(); it != records.end(); ++it) {
+                it->inTree = false;
+                overflow.insert(it.key());
+            }
+        }
+        return;
+    }
+
+    int changed = overflow.size() + staleEntries;
+    if (levels.isEmpty() || changed > qMax(64, int(records.size()) / 8))
+        rebuild();
+}
+
+void ItemIndex::rebuild()
+{
+    entries.clear();
+    entries.reserve(records.size());
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        it->inTree = true;
+        entries.append(Entry{it->rect, it.key()});
+    }
+    overflow.clear();
+    staleEntries = 0;
+    levels.clear();
+
+    // STR：先按中心 x 切成竖条，条内再按中心 y 排序后装入叶子
+    const int n = entries.size();
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.rect.center().x() < b.rect.center().x();
+    });
+    int leafCount = (n + NodeCapacity - 1) / NodeCapacity;
+    int sliceSize = qCeil(qSqrt(qreal(leafCount))) * NodeCapacity;
+    for (int start = 0; start < n; start += sliceSize) {
+        std::sort(entries.begin() + start, entries.begin() + qMin(n, start + sliceSize),
+                  [](const Entry &a, const Entry &b) {
+                      return a.rect.center().y() < b.rect.center().y();
+                  });
+    }
+
+    QVector<Node> leaves;
+    leaves.reserve(leafCount);
+    for (int start = 0; start < n; start += NodeCapacity) {
+        int count = qMin(NodeCapacity, n - start);
+        QRectF bounds = entries[start].rect;
+        for (int i = 1; i < count; ++i)
+            bounds = unite(bounds, entries[start + i].rect);
+        leaves.append(Node{bounds, start, count});
+    }
+    levels.append(leaves);
+
+    // 上层节点按顺序打包，STR 顺序已保证相邻节点在空间上接近
+    while (levels.last().size() > 1) {
+        QVector<Node> upper;
+        const QVector<Node> &below = levels.last();
+        for (int start = 0; start < below.size(); start += NodeCapacity) {
+            int count = qMin(NodeCapacity, int(below.size()) - start);
+            QRectF bounds = below[start].bounds;
+            for (int i = 1; i < count; ++i)
+                bounds = unite(bounds, below[start + i].bounds);
+            upper.append(Node{bounds, start, count});
+        }
+        levels.append(upper);
+    }
+}
+
+void ItemIndex::collect(int level, int index, const QRectF &rect, QList<QGraphicsItem *> &out) const
+{
+    const Node &node = levels[level][index];
+    if (!overlaps(node.bounds, rect))
+        return;
+
+    if (level == 0) {
+        for (int i = node.first; i < node.first + node.count; ++i) {
+            const Entry &entry = entries[i];
+            if (!overlaps(entry.rect, rect))
+                continue;
+            auto it = records.constFind(entry.item);
+            if (it != records.cend() && it->inTree)
+                out.append(entry.item);
+        }
+        return;
+    }
+
+    for (int i = node.first; i < node.first + node.count; ++i)
+        collect(level - 1, i, rect, out);
+}
+
+QList<QGraphicsItem *> ItemIndex::intersecting(const QRectF &rect) const
+{
+    QList<QGraphicsItem *> out;
+    if (!levels.isEmpty()) {
+        int top = levels.size() - 1;
+        for (int i = 0; i < levels[top].size(); ++i)
+            collect(top, i, rect, out);
+    }
+    for (QGraphicsItem *item : overflow) {
+        if (overlaps(records.value(item).rect, rect))
+            out.append(item);
+    }
+    return out;
+}
+
+quint64 ItemIndex::insertionOrder(QGraphicsItem *item) const
+{
+    return records.value(item).seq;
+}
+
+int ItemIndex::size() const
+{
+    return records.size();
+}
+
+bool ItemIndex::hasTree() const
+{
+    return !levels.isEmpty();
+}
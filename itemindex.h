@@ -0,0 +1,58 @@
+#ifndef ITEMINDEX_H
+#define ITEMINDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QRectF>
+
+class QGraphicsItem;
+
+// 顶层图形项的空间索引：批量构建的 R 树（STR 打包）+ 增量溢出表
+// 建树后移动或新增的图形项先放入溢出表线性检查，溢出过多时整体重建；
+// 图形项很少时不建树，直接线性扫描
+class ItemIndex
+{
+public:
+    void update(QGraphicsItem *item, const QRectF &sceneRect);
+    void remove(QGraphicsItem *item);
+    void clear();
+    void commit();  // 批量更新结束后调用，按需重建 R 树
+
+    // 返回包围盒与 rect 相交的图形项（闭区间，零尺寸矩形可用于点查询）
+    QList<QGraphicsItem *> intersecting(const QRectF &rect) const;
+    quint64 insertionOrder(QGraphicsItem *item) const;  // 同 Z 值时越大越靠上
+    int size() const;
+    bool hasTree() const;
+
+private:
+    struct Record {
+        QRectF rect;
+        quint64 seq;
+        bool inTree;
+    };
+    struct Entry {
+        QRectF rect;
+        QGraphicsItem *item;
+    };
+    struct Node {
+        QRectF bounds;
+        int first;   // 子节点（或叶子条目）起始下标
+        int count;
+    };
+
+    static const int NodeCapacity = 16;
+    static const int MinTreeSize = 256;  // 少于该数量时线性扫描更快
+
+    void rebuild();
+    void collect(int level, int index, const QRectF &rect, QList<QGraphicsItem *> &out) const;
+
+    QHash<QGraphicsItem *, Record> records;
+    QVector<Entry> entries;          // 叶子条目，按 STR 顺序排列
+    QVector<QVector<Node>> levels;   // levels[0] 指向 entries，levels[k] 指向 levels[k - 1]
+    QSet<QGraphicsItem *> overflow;  // 不在树中的图形项
+    int staleEntries = 0;            // 树中已失效的条目数
+    quint64 nextSeq = 0;
+};
+
+#endif // ITEMINDEX_H
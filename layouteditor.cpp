@@ -1,8 +1,16 @@
 #include "layouteditor.h"
 #include "textitem.h"
 #include "layouteditoritem.h"
+#include "htmlexporter.h"
+#include "imageloader.h"
+#include "carouselclock.h"
+#include "binarylayout.h"
+#include "framediagnostics.h"
+#include "tracer.h"
 #include <QGraphicsScene>
 #include <QPixmap>
+#include <QPixmapCache>
+#include <QPainter>
 #include <QMouseEvent>
 #include <QKeyEvent>
 #include <QMenu>
@@ -10,6 +18,17 @@
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QFile>
+#include <QFont>
+#include <QPalette>
+#include <QFileInfo>
+#include <QBuffer>
+#include <QRubberBand>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <memory>
 
 LayoutEditor::LayoutEditor(QWidget *parent) : QGraphicsView(parent)
 {
@@ -23,17 +42,155 @@ LayoutEditor::LayoutEditor(QWidget *parent) : QGraphicsView(parent)
     currentSnapLineV = QPointF(-1, -1);
     currentSnapLineH = QPointF(-1, -1);
     setDragMode(QGraphicsView::RubberBandDrag);          // 支持框选
+    // 视口沿用默认的 MinimalViewportUpdate，只重绘场景实际登记的脏区域：
+    // 移动图形项时为新旧位置，加上对齐线细条
     scene->setSelectionArea(QPainterPath());
-    scene->setItemIndexMethod(QGraphicsScene::NoIndex);
+    clock = new CarouselClock(this);
+    // 文字项按设备坐标缓存绘制结果，默认的像素缓存容量放不下几千个文字块
+    if (QPixmapCache::cacheLimit() < 64 * 1024)
+        QPixmapCache::setCacheLimit(64 * 1024);
+    history = std::make_unique<UndoHistory>(scene);
+    loadTimer = new QTimer(this);
+    loadTimer->setInterval(0);
+    connect(loadTimer, &QTimer::timeout, this, &LayoutEditor::insertNextBatch);
+    nudgeTimer = new QTimer(this);
+    nudgeTimer->setSingleShot(true);
+    nudgeTimer->setInterval(NudgeIntervalMs);
+    connect(nudgeTimer, &QTimer::timeout, this, &LayoutEditor::flushNudge);
+    autosaveTimer = new QTimer(this);
+    autosaveTimer->setInterval(AutosaveIntervalMs);
+    connect(autosaveTimer, &QTimer::timeout, this, &LayoutEditor::autosaveTick);
+
+    QString mode = qEnvironmentVariable("HTMLEDITOR_INDEX").toLower();
+    if (mode == "bsp")
+        setIndexMode(BspIndex);
+    else if (mode == "none")
+        setIndexMode(NoSceneIndex);
+    else
+        setIndexMode(RTreeIndex);
+}
+
+CarouselClock *LayoutEditor::carouselClock() const
+{
+    return clock;
+}
+
+LayoutEditor::IndexMode LayoutEditor::indexMode() const
+{
+    return currentIndexMode;
+}
+
+void LayoutEditor::setIndexMode(IndexMode mode)
+{
+    currentIndexMode = mode;
+    // R 树模式下由编辑器自己完成命中测试和框选；但点击、悬停仍由 Qt 分发，
+    // 它按场景索引查找图形项，NoIndex 下是线性扫描，所以 Qt 仍使用 BSP 索引
+    scene->setItemIndexMethod(mode == NoSceneIndex ? QGraphicsScene::NoIndex
+                                                   : QGraphicsScene::BspTreeIndex);
+    setDragMode(mode == RTreeIndex ? QGraphicsView::NoDrag
+                                   : QGraphicsView::RubberBandDrag);
+}
+
+namespace {
+// 在 item 及其子项中查找 scenePos 处最上层的可见图形项
+QGraphicsItem *topmostAt(QGraphicsItem *item, const QPointF &scenePos)
+{
+    if (!item->isVisible())
+        return nullptr;
+    const QList<QGraphicsItem *> children = item->childItems();  // 已按堆叠顺序排列
+    for (auto it = children.crbegin(); it != children.crend(); ++it) {
+        if ((*it)->flags() & QGraphicsItem::ItemStacksBehindParent)
+            continue;
+        if (QGraphicsItem *hit = topmostAt(*it, scenePos))
+            return hit;
+    }
+    if (item->contains(item->mapFromScene(scenePos)))
+        return item;
+    for (auto it = children.crbegin(); it != children.crend(); ++it) {
+        if (!((*it)->flags() & QGraphicsItem::ItemStacksBehindParent))
+            continue;
+        if (QGraphicsItem *hit = topmostAt(*it, scenePos))
+            return hit;
+    }
+    return nullptr;
+}
+}
+
+QGraphicsItem *LayoutEditor::hitItem(const QPointF &scenePos)
+{
+    if (currentIndexMode != RTreeIndex)
+        return scene->itemAt(scenePos, transform());
+
+    flushIndexes();
+    QList<QGraphicsItem *> candidates = itemIndex.intersecting(QRectF(scenePos, QSizeF(0, 0)));
+
+    // 顶层图形项按 Z 值、同 Z 时按插入顺序从上到下检查
+    std::sort(candidates.begin(), candidates.end(), [this](QGraphicsItem *a, QGraphicsItem *b) {
+        if (a->zValue() != b->zValue())
+            return a->zValue() > b->zValue();
+        return itemIndex.insertionOrder(a) > itemIndex.insertionOrder(b);
+    });
+    for (QGraphicsItem *item : candidates) {
+        if (QGraphicsItem *hit = topmostAt(item, scenePos))
+            return hit;
+    }
+    return nullptr;
+}
+
+void LayoutEditor::updateMarqueeSelection()
+{
+    QPolygonF area = mapToScene(rubberBand->geometry());
+    QPainterPath path;
+    path.addPolygon(area);
+    path.closeSubpath();
+
+    flushIndexes();
+    QSet<QGraphicsItem *> hits;
+    for (QGraphicsItem *item : itemIndex.intersecting(area.boundingRect())) {
+        if (!(item->flags() & QGraphicsItem::ItemIsSelectable) || !item->isVisible())
+            continue;
+        bool hit = item->collidesWithPath(item->mapFromScene(path), Qt::IntersectsItemShape);
+        // 组合的形状不含子项以外的区域，这里按子项判断
+        if (!hit) {
+            const QList<QGraphicsItem *> children = item->childItems();
+            for (QGraphicsItem *child : children) {
+                if (child->collidesWithPath(child->mapFromScene(path), Qt::IntersectsItemShape)) {
+                    hit = true;
+                    break;
+                }
+            }
+        }
+        if (hit)
+            hits.insert(item);
+    }
+
+    // 只切换状态发生变化的图形项，避免每次移动都重新选择全部
+    for (auto it = marqueeSelection.begin(); it != marqueeSelection.end(); ) {
+        if (!hits.contains(*it)) {
+            (*it)->setSelected(false);
+            it = marqueeSelection.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (QGraphicsItem *item : hits) {
+        if (!item->isSelected()) {
+            item->setSelected(true);
+            marqueeSelection.insert(item);
+        }
+    }
 }
 
 void LayoutEditor::addImageItem(const QString &filePath)
 {
-    QPixmap pix(filePath);
-    auto *item = new LayoutEditorItem(pix, filePath);
+    // 解码放到后台线程，先插入占位框
+    auto *item = new LayoutEditorItem(filePath, QSizeF(200, 150));
     item->setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable);
     scene->addItem(item);
     item->setPos(scene->sceneRect().center());
+    ImageLoader::instance()->load(item, filePath, [item](const QPixmap &pixmap) {
+        item->setImage(pixmap);
+    });
 }
 
 void LayoutEditor::addTextItem(const QString &text)
@@ -45,27 +202,10 @@ void LayoutEditor::addTextItem(const QString &text)
 
 QString LayoutEditor::generateHTML() const
 {
-    QString html = "<!DOCTYPE html>\n<html>\n<head><meta charset=\"utf-8\">\n"
-                   "</head>\n<body>\n";
-
-    for (auto *item : scene->items()) {
-        if (auto *imgItem = qgraphicsitem_cast<LayoutEditorItem *>(item)) {
-            QRectF bounds = imgItem->sceneBoundingRect();
-            QString imgTag = QString("<img src=\"%1\" style=\"position:absolute; left:%2px; top:%3px; width:%4px; height:%5px;\">\n")
-                                 .arg(imgItem->source())
-                                 .arg(int(bounds.left()))
-                                 .arg(int(bounds.top()))
-                                 .arg(int(bounds.width()))
-                                 .arg(int(bounds.height()));
-            html += imgTag;
-        }
-        else if (auto *textItem = qgraphicsitem_cast<TextItem *>(item)) {
-            html += textItem->toHtml();  // 样式导出
-        }
-    }
-
-    html += "</body>\n</html>\n";
-    return html;
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    HtmlExporter(scene).exportTo(&buffer);
+    return QString::fromUtf8(buffer.data());
 }
 
 QGraphicsScene *LayoutEditor::getScene() const
@@ -75,21 +215,50 @@ QGraphicsScene *LayoutEditor::getScene() const
 
 void LayoutEditor::mousePressEvent(QMouseEvent *event)
 {
+    if (diagnostics)
+        diagnostics->inputReceived();
+    flushNudge();
     lastMousePos = event->pos();
     draggingItem = nullptr;
     QPointF scenePos = mapToScene(event->pos());
-    QGraphicsItem *item = QGraphicsView::scene()->itemAt(scenePos, transform());
+    QGraphicsItem *item = hitItem(scenePos);
 
     if (item && item->isSelected())
         draggingItem = item;
 
     QGraphicsView::mousePressEvent(event);
 
+    dragMoves.clear();
+    if (item && event->button() == Qt::LeftButton) {
+        const QList<QGraphicsItem *> selected = scene->selectedItems();
+        for (QGraphicsItem *moving : selected)
+            dragMoves.append({ moving, moving->pos(), moving->pos() });
+    }
+
+    // R 树模式下点击空白处开始框选（场景已按 Ctrl 状态处理了原有选区）
+    if (currentIndexMode == RTreeIndex && !item && event->button() == Qt::LeftButton) {
+        marqueeSelection.clear();
+        if (!rubberBand)
+            rubberBand = new QRubberBand(QRubberBand::Rectangle, viewport());
+        rubberOrigin = event->pos();
+        rubberBand->setGeometry(QRect(rubberOrigin, QSize()));
+        rubberBand->show();
+        rubberSelecting = true;
+    }
+
 
 }
 
 void LayoutEditor::mouseMoveEvent(QMouseEvent *event)
 {
+    if (diagnostics)
+        diagnostics->inputReceived();
+    if (rubberSelecting) {
+        rubberBand->setGeometry(QRect(rubberOrigin, event->pos()).normalized());
+        updateMarqueeSelection();
+        return;
+    }
+
     QGraphicsView::mouseMoveEvent(event);
 
     if (!draggingItem || !(event->buttons() & Qt::LeftButton))
@@ -111,77 +280,241 @@ void LayoutEditor::mouseMoveEvent(QMouseEvent *event)
         snappedPos.setX(qRound(snappedPos.x() / gridSize) * gridSize);
         snappedPos.setY(qRound(snappedPos.y() / gridSize) * gridSize);
     }
-    draggingItem->setPos(snappedPos);
-
-    viewport()->update();
+    draggingItem->setPos(snappedPos);  // 场景自行登记新旧位置的脏区域
 }
 
 
 
 QPointF LayoutEditor::trySnap(QGraphicsItem *movingItem, QPointF newPos)
 {
-    QRectF movingRect = movingItem->boundingRect().translated(newPos);
-    currentSnapLineV = QPointF(-1, -1);
-    currentSnapLineH = QPointF(-1, -1);
+    TraceSpan span("trySnap", "snap");
+    flushIndexes(movingItem);
 
-    for (auto *item : scene->items()) {
-        if (item == movingItem) continue;
+    QRectF itemRect = movingItem->boundingRect();
+    QRectF movingRect = itemRect.translated(newPos);
+    QPointF snapLineV(-1, -1);
+    QPointF snapLineH(-1, -1);
 
-        QRectF other = item->sceneBoundingRect();
+    qreal guide;
 
-        // 横向吸附
-        if (std::abs(movingRect.top() - other.top()) < snapThreshold) {
-            newPos.setY(other.top() - movingItem->boundingRect().top());
-            currentSnapLineH = QPointF(0, other.top());
-        }
-        else if (std::abs(movingRect.center().y() - other.center().y()) < snapThreshold) {
-            newPos.setY(other.center().y() - movingItem->boundingRect().height() / 2);
-            currentSnapLineH = QPointF(0, other.center().y());
-        }
+    // 横向吸附：上边优先，其次垂直中心
+    if (snapIndex.nearest(SnapIndex::Top, movingRect.top(), snapThreshold, movingItem, &guide)) {
+        newPos.setY(guide - itemRect.top());
+        snapLineH = QPointF(0, guide);
+    }
+    else if (snapIndex.nearest(SnapIndex::CenterY, movingRect.center().y(), snapThreshold, movingItem, &guide)) {
+        newPos.setY(guide - itemRect.height() / 2);
+        snapLineH = QPointF(0, guide);
+    }
+
+    // 纵向吸附：左边优先，其次水平中心
+    if (snapIndex.nearest(SnapIndex::Left, movingRect.left(), snapThreshold, movingItem, &guide)) {
+        newPos.setX(guide - itemRect.left());
+        snapLineV = QPointF(guide, 0);
+    }
+    else if (snapIndex.nearest(SnapIndex::CenterX, movingRect.center().x(), snapThreshold, movingItem, &guide)) {
+        newPos.setX(guide - itemRect.width() / 2);
+        snapLineV = QPointF(guide, 0);
+    }
 
-        // 纵向吸附
-        if (std::abs(movingRect.left() - other.left()) < snapThreshold) {
-            newPos.setX(other.left() - movingItem->boundingRect().left());
-            currentSnapLineV = QPointF(other.left(), 0);
+    setSnapLines(snapLineV, snapLineH);
+    return newPos;
+}
+
+void LayoutEditor::setSnapLines(const QPointF &vertical, const QPointF &horizontal)
+{
+    if (vertical != currentSnapLineV) {
+        updateSnapLineStrip(currentSnapLineV, Qt::Vertical);
+        updateSnapLineStrip(vertical, Qt::Vertical);
+        currentSnapLineV = vertical;
+    }
+    if (horizontal != currentSnapLineH) {
+        updateSnapLineStrip(currentSnapLineH, Qt::Horizontal);
+        updateSnapLineStrip(horizontal, Qt::Horizontal);
+        currentSnapLineH = horizontal;
+    }
+}
+
+void LayoutEditor::updateSnapLineStrip(const QPointF &line, Qt::Orientation orientation)
+{
+    // 竖线记在 x 上，横线记在 y 上，负值表示没有；虚线宽 1 像素，两侧各留 2 像素给抗锯齿
+    const int margin = 2;
+    QPoint pos = mapFromScene(line);
+    if (orientation == Qt::Vertical && line.x() >= 0)
+        viewport()->update(pos.x() - margin, 0, 2 * margin + 1, viewport()->height());
+    else if (orientation == Qt::Horizontal && line.y() >= 0)
+        viewport()->update(0, pos.y() - margin, viewport()->width(), 2 * margin + 1);
+}
+
+LayoutEditor *LayoutEditor::fromScene(const QGraphicsScene *scene)
+{
+    if (!scene)
+        return nullptr;
+    const QList<QGraphicsView *> views = scene->views();
+    for (QGraphicsView *view : views) {
+        if (auto *editor = qobject_cast<LayoutEditor *>(view))
+            return editor;
+    }
+    return nullptr;
+}
+
+void LayoutEditor::trackItemChange(QGraphicsItem *item, QGraphicsItem::GraphicsItemChange change)
+{
+    LayoutEditor *editor = fromScene(item->scene());
+    if (!editor)
+        return;
+
+    switch (change) {
+    case QGraphicsItem::ItemSceneChange:          // 即将离开当前场景
+        editor->itemRemoved(item);
+        break;
+    case QGraphicsItem::ItemSceneHasChanged:
+    case QGraphicsItem::ItemPositionHasChanged:
+    case QGraphicsItem::ItemTransformHasChanged:
+    case QGraphicsItem::ItemParentHasChanged:     // 组合/取消组合
+        editor->itemGeometryChanged(item);
+        break;
+    default:
+        break;
+    }
+}
+
+void LayoutEditor::itemGeometryChanged(QGraphicsItem *item)
+{
+    pendingIndexItems.insert(item);
+    autosave.markChanged(item);
+}
+
+void LayoutEditor::itemRemoved(QGraphicsItem *item)
+{
+    pendingIndexItems.remove(item);
+    marqueeSelection.remove(item);
+    if (transactionDepth > 0)
+        transactionRemoved.insert(item);  // 逐个删除要移动有序数组，留到事务结束一起处理
+    else
+        snapIndex.remove(item);
+    itemIndex.remove(item);
+    autosave.markRemoved(item);
+}
+
+void LayoutEditor::itemContentChanged(QGraphicsItem *item)
+{
+    autosave.markChanged(item);
+}
+
+void LayoutEditor::flushIndexes(const QGraphicsItem *skip)
+{
+    // 只对上次查询以来发生变化的图形项更新索引，代价与变化数量成正比；
+    // 变化较多时（如移动一大片选区）吸附索引整体合并，避免逐个插入有序数组
+    const int BulkThreshold = 64;
+    const bool bulk = pendingIndexItems.size() > BulkThreshold;
+    QVector<SnapIndex::Change> snapChanges;
+    QSet<QGraphicsItem *> snapRemovals;
+
+    for (auto it = pendingIndexItems.begin(); it != pendingIndexItems.end(); ) {
+        QGraphicsItem *item = *it;
+        if (item == skip) {
+            ++it;
+            continue;
         }
-        else if (std::abs(movingRect.center().x() - other.center().x()) < snapThreshold) {
-            newPos.setX(other.center().x() - movingItem->boundingRect().width() / 2);
-            currentSnapLineV = QPointF(other.center().x(), 0);
+        // 只有顶层图形项参与吸附，组合内的子项与缩放手柄不作为参考；
+        // 命中索引记录包含子项在内的范围，子项由 hitItem 逐层检查
+        if (item->scene() == scene && !item->parentItem()) {
+            QRectF bounds = item->sceneBoundingRect();
+            if (bulk)
+                snapChanges.append({ item, bounds });
+            else
+                snapIndex.update(item, bounds);
+            itemIndex.update(item, bounds.united(item->mapRectToScene(item->childrenBoundingRect())));
+        } else {
+            if (bulk)
+                snapRemovals.insert(item);
+            else
+                snapIndex.remove(item);
+            itemIndex.remove(item);
         }
+        it = pendingIndexItems.erase(it);
     }
+    if (!snapRemovals.isEmpty())
+        snapIndex.remove(snapRemovals);
+    if (!snapChanges.isEmpty())
+        snapIndex.update(snapChanges);
+    itemIndex.commit();
+}
 
-    return newPos;
+void LayoutEditor::paintEvent(QPaintEvent *event)
+{
+    TraceSpan span("paint", "paint");
+    if (diagnostics) {
+        // 浮层要读取索引中的数量；在计时开始前写入索引，绘制过程中不修改编辑器状态
+        flushIndexes();
+        diagnostics->beginFrame();
+    }
+    QGraphicsView::paintEvent(event);
+    if (diagnostics)
+        diagnostics->endFrame();
 }
 
 void LayoutEditor::drawForeground(QPainter *painter, const QRectF &rect)
 {
+    if (diagnostics)
+        diagnostics->foregroundStarted();
     QGraphicsView::drawForeground(painter, rect);
 
     painter->setPen(QPen(Qt::red, 1, Qt::DashLine));
 
+    // 只画到本次重绘的范围，其余部分由细条重绘负责
     if (currentSnapLineV.x() >= 0)
-        painter->drawLine(QLineF(currentSnapLineV.x(), 0, currentSnapLineV.x(), height()));
+        painter->drawLine(QLineF(currentSnapLineV.x(), rect.top(), currentSnapLineV.x(), rect.bottom()));
     if (currentSnapLineH.y() >= 0)
-        painter->drawLine(QLineF(0, currentSnapLineH.y(), width(), currentSnapLineH.y()));
+        painter->drawLine(QLineF(rect.left(), currentSnapLineH.y(), rect.right(), currentSnapLineH.y()));
+
+    if (diagnostics) {
+        diagnostics->foregroundDone();
+        drawDiagnostics(painter);
+    }
+}
+
+void LayoutEditor::setDiagnosticsVisible(bool visible)
+{
+    if (visible == bool(diagnostics))
+        return;
+    restoreUpdateMode();
+    if (visible) {
+        diagnostics = std::make_unique<FrameDiagnostics>();
+        // 浮层固定在视口上，滚动时不能复用已有像素
+        updateModeBeforeDiagnostics = viewportUpdateMode();
+        setViewportUpdateMode(FullViewportUpdate);
+    } else {
+        diagnostics.reset();
+        setViewportUpdateMode(updateModeBeforeDiagnostics);
+    }
+    viewport()->update();
+}
+
+void LayoutEditor::drawDiagnostics(QPainter *painter)
+{
+    // 顶层图形项数量取自命中索引，可见数量按当前视口查询；索引已在 paintEvent 中写入
+    QRectF visible = mapToScene(viewport()->rect()).boundingRect();
+    int visibleCount = currentIndexMode == RTreeIndex ? int(itemIndex.intersecting(visible).size())
+                                                      : int(scene->items(visible).size());
+
+    painter->save();
+    painter->resetTransform();
+    diagnostics->draw(painter, viewport()->rect(), itemIndex.size(), visibleCount);
+    painter->restore();
 }
 
 void LayoutEditor::keyPressEvent(QKeyEvent *event)
 {
+    if (diagnostics)
+        diagnostics->inputReceived();
     if (QGraphicsTextItem *textItem = dynamic_cast<QGraphicsTextItem *>(scene->focusItem())) {
         QGraphicsView::keyPressEvent(event);  // 把事件交给文本项处理（编辑文字）
         return;
     }
-    if (event->key() == Qt::Key_Backspace) {
-        QList<QGraphicsItem*> selected = scene->selectedItems();
-        for (QGraphicsItem *item : selected) {
-            if (auto *group = dynamic_cast<QGraphicsItemGroup *>(item)) {
-                scene->destroyItemGroup(group);
-            } else {
-                scene->removeItem(item);
-                delete item;
-            }
-        }
-    }
+    if (event->key() == Qt::Key_Backspace)
+        deleteItems(scene->selectedItems());
     // 判断移动步长
     int delta = event->modifiers() & Qt::ShiftModifier ? 10 : 1;
 
@@ -197,37 +530,63 @@ void LayoutEditor::keyPressEvent(QKeyEvent *event)
         return;
     }
 
-    // 移动所有选中的图形项
-    for (auto *item : scene->selectedItems()) {
-        item->moveBy(offset.x(), offset.y());
+    // 第一下立即移动；按住不放时，同一帧内到达的自动重复只累加，到时一次移动
+    pendingNudge += offset;
+    if (!nudgeTimer->isActive()) {
+        flushNudge();
+        nudgeTimer->start();
     }
+}
 
-    viewport()->update();  // 更新画布显示
-
-
+void LayoutEditor::flushNudge()
+{
+    if (pendingNudge.isNull())
+        return;
+    QPointF offset = pendingNudge;
+    pendingNudge = QPointF();
+    moveItems(scene->selectedItems(), offset);
 }
 
 void LayoutEditor::mouseReleaseEvent(QMouseEvent *event)
 {
+    if (diagnostics)
+        diagnostics->inputReceived();
+    if (draggingItem)
+        itemGeometryChanged(draggingItem);
+
+    // 一次拖动记为一步，与相邻的同一组图形项的移动合并
+    QVector<UndoHistory::Move> moved;
+    for (UndoHistory::Move &move : dragMoves) {
+        move.to = move.item->pos();
+        if (move.to != move.from)
+            moved.append(move);
+    }
+    dragMoves.clear();
+    history->pushMoves(moved);
+
+    if (rubberSelecting) {
+        rubberSelecting = false;
+        rubberBand->hide();
+        marqueeSelection.clear();
+    }
+
     QPointF scenePos = mapToScene(event->pos());
-    QGraphicsItem *item = QGraphicsView::scene()->itemAt(scenePos, transform());
+    QGraphicsItem *item = hitItem(scenePos);
 
     if (item && item->isSelected())
         draggingItem = item;
     else
         draggingItem = nullptr;
 
-    // 清除对齐线状态
-    currentSnapLineH = QPointF(-1, -1);
-    currentSnapLineV = QPointF(-1, -1);
+    // 清除对齐线，只重绘它们所在的细条
+    setSnapLines(QPointF(-1, -1), QPointF(-1, -1));
     QGraphicsView::mouseReleaseEvent(event);
-    viewport()->update();  // 强制重绘以移除红线
 }
 
 void LayoutEditor::contextMenuEvent(QContextMenuEvent *event)
 {
     QPointF scenePos = mapToScene(event->pos());
-    QGraphicsItem *clickedItem = QGraphicsView::scene()->itemAt(scenePos, transform());
+    QGraphicsItem *clickedItem = hitItem(scenePos);
 
     if (!clickedItem) return;
 
@@ -241,17 +600,8 @@ void LayoutEditor::contextMenuEvent(QContextMenuEvent *event)
         groupSelectedItems();
     else if (selected == ungroupAction)
         ungroupSelectedItems();
-    else if (selected == deleteAction) {
-        QList<QGraphicsItem *> selectedItems = scene->selectedItems();
-        for (QGraphicsItem *item : selectedItems) {
-            if (auto *group = dynamic_cast<QGraphicsItemGroup *>(item)) {
-                scene->destroyItemGroup(group);
-            } else {
-                scene->removeItem(item);
-                delete item;
-            }
-        }
-    }
+    else if (selected == deleteAction)
+        deleteItems(scene->selectedItems());
 }
 
 void LayoutEditor::groupSelectedItems()
@@ -265,36 +615,175 @@ void LayoutEditor::groupSelectedItems()
                     QGraphicsItem::ItemIsSelectable |
                     QGraphicsItem::ItemIsFocusable);
     group->setZValue(100);  // 保证不被遮挡
+    itemGeometryChanged(group);
+
+    UndoHistory::Entry entry;
+    entry.formed.append({ group, group->childItems() });
+    history->push(entry);
 }
 
 void LayoutEditor::ungroupSelectedItems()
 {
-    QList<QGraphicsItem *> selected = scene->selectedItems();
+    // 组合对象由撤销历史保留，撤销时原样恢复
+    UndoHistory::Entry entry;
+    const QList<QGraphicsItem *> selected = scene->selectedItems();
+    for (QGraphicsItem *item : selected) {
+        if (auto *group = dynamic_cast<QGraphicsItemGroup *>(item))
+            entry.dissolved.append({ group, group->childItems() });
+    }
+    history->apply(entry, true);
+    history->push(entry);
+}
 
+void LayoutEditor::beginTransaction()
+{
+    if (transactionDepth++ > 0)
+        return;
+    // 诊断浮层打开时本来就整屏重绘
+    if (!updateModePending && viewportUpdateMode() != FullViewportUpdate) {
+        updateModeBeforeTransaction = viewportUpdateMode();
+        setViewportUpdateMode(BoundingRectViewportUpdate);
+        updateModePending = true;
+    }
+}
+
+void LayoutEditor::endTransaction()
+{
+    if (--transactionDepth > 0)
+        return;
+    if (!transactionRemoved.isEmpty()) {
+        snapIndex.remove(transactionRemoved);
+        transactionRemoved.clear();
+    }
+    // 场景处理脏区域的调用已排在事件队列里，等它执行完再恢复
+    if (updateModePending)
+        QMetaObject::invokeMethod(this, [this]() { restoreUpdateMode(); }, Qt::QueuedConnection);
+}
+
+void LayoutEditor::restoreUpdateMode()
+{
+    if (!updateModePending)
+        return;
+    updateModePending = false;
+    setViewportUpdateMode(updateModeBeforeTransaction);
+}
+
+void LayoutEditor::moveItems(const QList<QGraphicsItem *> &items, const QPointF &offset)
+{
+    if (items.isEmpty() || offset.isNull())
+        return;
+    Transaction transaction(this);
+    QVector<UndoHistory::Move> moves;
+    moves.reserve(items.size());
+    for (QGraphicsItem *item : items) {
+        QPointF from = item->pos();
+        item->moveBy(offset.x(), offset.y());
+        itemGeometryChanged(item);  // 组合没有位置变化通知，这里统一登记
+        moves.append({ item, from, item->pos() });
+    }
+    history->pushMoves(moves);  // 连续按方向键只占一步
+}
+
+void LayoutEditor::applyTextStyle(const std::function<void(TextItem *)> &change)
+{
+    Transaction transaction(this);
+    const QList<QGraphicsItem *> selected = scene->selectedItems();
     for (QGraphicsItem *item : selected) {
-        if (auto *group = dynamic_cast<QGraphicsItemGroup *>(item)) {
-            scene->destroyItemGroup(group);
+        if (auto *textItem = qgraphicsitem_cast<TextItem *>(item)) {
+            change(textItem);
+            itemContentChanged(textItem);
         }
     }
 }
 
+void LayoutEditor::deleteItems(const QList<QGraphicsItem *> &items)
+{
+    flushNudge();
+    Transaction transaction(this);
+    UndoHistory::Entry entry;
+    for (QGraphicsItem *item : items) {
+        if (auto *group = dynamic_cast<QGraphicsItemGroup *>(item))
+            entry.dissolved.append({ group, group->childItems() });
+        else
+            entry.removals.append({ item, item->parentItem() });
+    }
+    history->apply(entry, true);
+    history->push(entry);
+}
+
+void LayoutEditor::recordResize(LayoutEditorItem *item, const QSizeF &from, const QSizeF &to)
+{
+    if (from == to)
+        return;
+    UndoHistory::Entry entry;
+    entry.resizes.append({ item, from, to });
+    history->push(entry);
+}
+
+void LayoutEditor::undo()
+{
+    // 索引和自动保存都是延迟更新的，批量撤销只在事务结束后整体重绘一次
+    flushNudge();
+    Transaction transaction(this);
+    history->undo();
+}
+
+void LayoutEditor::redo()
+{
+    flushNudge();
+    Transaction transaction(this);
+    history->redo();
+}
+
 void LayoutEditor::drawBackground(QPainter *painter, const QRectF &rect)
 {
-    if (!showGrid) return;
+    if (showGrid)
+        drawGrid(painter, rect);
+    if (diagnostics)
+        diagnostics->backgroundDone();
+}
 
-    QPen pen(QColor(230, 230, 230));
-    pen.setWidth(1);
-    painter->setPen(pen);
+void LayoutEditor::drawGrid(QPainter *painter, const QRectF &rect)
+{
 
-    int left = static_cast<int>(rect.left());
-    int right = static_cast<int>(rect.right());
-    int top = static_cast<int>(rect.top());
-    int bottom = static_cast<int>(rect.bottom());
+    // 缩小显示时网格过密，间距翻倍直到不小于 4 个设备像素
+    const qreal minSpacing = 4;
+    qreal scale = qMax(qAbs(transform().m11()), 0.001);
+    int step = gridSize;
+    while (step * scale < minSpacing)
+        step *= 2;
+
+    // 窗口移到像素比不同的屏幕上时也要重建，否则高分屏上网格发虚
+    qreal ratio = viewport()->devicePixelRatioF();
+    if (gridTile.isNull() || step != gridTileStep || scale != gridTileScale || ratio != gridTileRatio)
+        rebuildGridTile(step, scale, ratio);
+
+    // 平铺图按设备像素绘制，画刷变换把它还原为一个网格间距的场景大小
+    QBrush brush(gridTile);
+    qreal factor = qreal(step) / gridTile.deviceIndependentSize().width();
+    brush.setTransform(QTransform::fromScale(factor, factor));
+    painter->fillRect(rect, brush);
+}
 
-    for (int x = left - (left % gridSize); x <= right; x += gridSize)
-        painter->drawLine(x, top, x, bottom);
-    for (int y = top - (top % gridSize); y <= bottom; y += gridSize)
-        painter->drawLine(left, y, right, y);
+void LayoutEditor::rebuildGridTile(int step, qreal scale, qreal ratio)
+{
+    int pixels = qMax(1, qRound(step * scale * ratio));
+    gridTile = QPixmap(pixels, pixels);
+    gridTile.setDevicePixelRatio(ratio);
+    gridTile.fill(Qt::transparent);
+    qreal tileSize = pixels / ratio;  // 逻辑坐标
+
+    QPainter tilePainter(&gridTile);
+    QPen pen(QColor(230, 230, 230));
+    pen.setWidth(0);  // 1 个设备像素宽的细线
+    tilePainter.setPen(pen);
+    tilePainter.drawLine(QPointF(0, 0), QPointF(tileSize, 0));
+    tilePainter.drawLine(QPointF(0, 0), QPointF(0, tileSize));
+    tilePainter.end();
+
+    gridTileStep = step;
+    gridTileScale = scale;
+    gridTileRatio = ratio;
 }
 
 void LayoutEditor::toggleGrid()
@@ -310,6 +799,8 @@ void LayoutEditor::toggleSnapToGrid()
 
 void LayoutEditor::saveToJson(const QString &filePath)
 {
+    TraceSpan span("saveToJson", "save");
+    flushNudge();  // 按住方向键时可能还有未应用的位移
     QJsonArray itemArray;
 
     for (QGraphicsItem *item : scene->items()) {
@@ -351,40 +842,337 @@ void LayoutEditor::saveToJson(const QString &filePath)
 
 void LayoutEditor::loadFromJson(const QString &filePath)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return;
-
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    file.close();
-
-    scene->clear();  // 清除旧的元素
-
-    QJsonArray items = doc.object()["items"].toArray();
-    for (const QJsonValue &val : items) {
-        QJsonObject obj = val.toObject();
-        QString type = obj["type"].toString();
-
-        if (type == "image") {
-            QString src = obj["source"].toString();
-            QPixmap pix(src);
-            if (!pix.isNull()) {
-                auto *img = new LayoutEditorItem(pix, src);
-                img->setFlags(QGraphicsItem::ItemIsSelectable);
-                scene->addItem(img);
-                img->setPos(obj["x"].toDouble(), obj["y"].toDouble());
-                // 可加缩放
+    cancelLoad();  // 新的载入取代尚未完成的载入
+
+    // 读文件和解析都在工作线程中完成
+    parseWatcher = new QFutureWatcher<ParsedLayout>(this);
+    QFutureWatcher<ParsedLayout> *watcher = parseWatcher;
+    connect(watcher, &QFutureWatcher<ParsedLayout>::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        if (watcher != parseWatcher)
+            return;  // 已被取消
+        parseWatcher = nullptr;
+        startInsert(watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run([filePath]() {
+        TraceSpan span("parse json", "load");
+        ParsedLayout parsed;
+        QFile file(filePath);
+        if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+            parsed.ok = parseLayoutJson(file.readAll(), &parsed.records);
+        return parsed;
+    }));
+}
+
+bool LayoutEditor::isLoading() const
+{
+    return parseWatcher || loadTimer->isActive();
+}
+
+void LayoutEditor::cancelLoad()
+{
+    if (!isLoading())
+        return;
+    stopLoad();
+    emit loadFinished(false);
+}
+
+void LayoutEditor::stopLoad()
+{
+    // 解析任务无法中途停止，丢弃它的结果即可
+    parseWatcher = nullptr;
+    loadTimer->stop();
+    loadRecords.clear();
+    loadNext = 0;
+}
+
+void LayoutEditor::startInsert(const ParsedLayout &parsed)
+{
+    if (!parsed.ok) {
+        emit loadFinished(false);  // 有意改变：原来解析前就清空场景，现在文件无效时保留当前场景
+        return;
+    }
+
+    resetScene();  // 清除旧的元素
+    loadRecords = parsed.records;
+    loadNext = 0;
+    emit loadProgress(0, loadRecords.size());
+    insertNextBatch();  // 第一批立即插入，视口不会先空一帧
+}
+
+void LayoutEditor::insertNextBatch()
+{
+    TraceSpan span("insert batch", "load");
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const int total = loadRecords.size();
+    while (loadNext < total) {
+        addRecord(loadRecords[loadNext++]);
+        if (elapsed.elapsed() >= LoadSliceMs)
+            break;
+    }
+    emit loadProgress(loadNext, total);
+
+    if (loadNext < total) {
+        loadTimer->start();
+        return;
+    }
+    stopLoad();
+    emit loadFinished(true);
+}
+
+const QGraphicsItem::GraphicsItemFlags LayoutEditor::RecordImageFlags = QGraphicsItem::ItemIsSelectable;
+const QGraphicsItem::GraphicsItemFlags LayoutEditor::RecordTextFlags =
+    QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemIsFocusable;
+
+int LayoutEditor::recordPointSize(const LayoutRecord &record, int defaultSize)
+{
+    return record.fontSize > 0 ? record.fontSize : defaultSize;
+}
+
+LayoutEditor::TextDefaults LayoutEditor::textDefaults()
+{
+    // QGraphicsTextItem 未设置颜色时使用应用程序调色板的文字颜色
+    TextDefaults defaults;
+    defaults.pointSize = QFont().pointSize();
+    defaults.color = QPalette().color(QPalette::Text).rgba();
+    return defaults;
+}
+
+void LayoutEditor::snapshotRecords(const QVector<LayoutRecord> &records, const TextDefaults &defaults,
+                                   const std::function<QSize(const QString &)> &imageSize,
+                                   QVector<HtmlExporter::ItemSnapshot> *out)
+{
+    // 后载入的图形项在上层，scene->items() 从上到下，因此倒序
+    out->reserve(out->size() + records.size());
+    for (int i = records.size() - 1; i >= 0; --i) {
+        const LayoutRecord &record = records[i];
+        HtmlExporter::ItemSnapshot item;
+        if (record.type == LayoutRecord::Image) {
+            QSize size = imageSize(record.content);
+            if (size.isEmpty())
+                continue;  // finishImageLoad 会移除无法读取的图片
+            QRectF bounds = LayoutEditorItem::imageBounds(QSizeF(size), RecordImageFlags.testFlag(QGraphicsItem::ItemIsSelectable))
+                                .translated(record.pos);
+            item.kind = HtmlExporter::ItemSnapshot::Image;
+            item.x = int(bounds.left());
+            item.y = int(bounds.top());
+            item.width = int(bounds.width());
+            item.height = int(bounds.height());
+            item.content = record.content;
+        } else {
+            item.kind = HtmlExporter::ItemSnapshot::Text;
+            item.x = int(record.pos.x());
+            item.y = int(record.pos.y());
+            item.content = record.content;
+            item.fontFamily = record.fontFamily;
+            item.fontSize = recordPointSize(record, defaults.pointSize);
+            item.bold = record.bold;
+            item.color = QColor::fromRgba(record.hasColor ? record.color : defaults.color).name();
+        }
+        out->append(item);
+    }
+}
+
+void LayoutEditor::addRecord(const LayoutRecord &record, const std::shared_ptr<BinaryLayout::Reader> &reader)
+{
+    if (record.type == LayoutRecord::Image) {
+        auto *img = new LayoutEditorItem(record.content, record.size);  // 以保存的尺寸作占位
+        img->setFlags(RecordImageFlags);
+        scene->addItem(img);
+        img->setPos(record.pos);
+
+        auto done = [this, img](const QPixmap &pixmap) { finishImageLoad(img, pixmap); };
+        if (!reader) {
+            ImageLoader::instance()->load(img, record.content, done);
+            return;
+        }
+
+        // 映射由引用内嵌图片的图形项共同持有，最后一个图形项删除后才解除映射
+        if (record.blob >= 0)
+            img->setEmbeddedBlob(reader, record.blob);
+        QString src = record.content;
+        img->setDeferredLoader([img, src, done]() {
+            QByteArray data = img->embeddedData();
+            if (!data.isEmpty())
+                ImageLoader::instance()->loadEncoded(img, data, img->embeddedKey(), img->embeddedReader(), done);
+            else
+                ImageLoader::instance()->load(img, src, done);
+        });
+    } else {
+        auto *txt = new TextItem();
+        txt->setPlainText(record.content);
+        QFont font;
+        font.setPointSize(recordPointSize(record, font.pointSize()));
+        font.setBold(record.bold);
+        font.setFamily(record.fontFamily);
+        txt->setFont(font);
+        if (record.hasColor)
+            txt->setDefaultTextColor(QColor::fromRgba(record.color));
+        txt->setFlags(RecordTextFlags);
+        scene->addItem(txt);
+        txt->setPos(record.pos);
+    }
+}
+
+void LayoutEditor::resetScene()
+{
+    history->clear();  // 先释放历史持有的、已不在场景中的图形项
+    pendingNudge = QPointF();
+    pendingIndexItems.clear();
+    marqueeSelection.clear();
+    snapIndex.clear();
+    itemIndex.clear();
+    autosave.reset();
+    scene->clear();
+}
+
+void LayoutEditor::finishImageLoad(LayoutEditorItem *item, const QPixmap &pixmap)
+{
+    if (pixmap.isNull()) {
+        // 与原来一致：无法读取的图片不保留在场景中
+        history->forget(item);
+        if (item->scene())
+            scene->removeItem(item);
+        delete item;
+        return;
+    }
+    item->setImage(pixmap);
+    // 可加缩放
+}
+
+bool LayoutEditor::itemRecord(const QGraphicsItem *item, LayoutRecord *record)
+{
+    // 使用场景坐标，组合内的图形项读回后位置不变
+    if (auto *img = dynamic_cast<const LayoutEditorItem *>(item)) {
+        record->type = LayoutRecord::Image;
+        record->pos = img->scenePos();
+        record->size = img->boundingRect().size();
+        record->content = img->source();
+        return true;
+    }
+    if (auto *text = dynamic_cast<const TextItem *>(item)) {
+        QFont font = text->font();
+        record->type = LayoutRecord::Text;
+        record->pos = text->scenePos();
+        record->size = text->boundingRect().size();
+        record->content = text->toPlainText();
+        record->fontFamily = font.family();
+        record->fontSize = font.pointSize();
+        record->bold = font.bold();
+        record->hasColor = true;
+        record->color = text->defaultTextColor().rgba();
+        return true;
+    }
+    return false;
+}
+
+bool LayoutEditor::saveToBinary(const QString &filePath, bool embedImages)
+{
+    TraceSpan span("saveToBinary", "save");
+    flushNudge();
+    BinaryLayout::Writer writer;
+    QHash<QString, int> embedded;  // 同一路径只读取一次
+    const QList<QGraphicsItem *> items = scene->items();
+
+    // 覆盖保存当前映射着的项目文件：先把内嵌图片复制出来，不再引用旧文件的映射。
+    // 否则 Windows 下映射未解除，替换文件会失败
+    // 撤销历史持有的已删除图形项同样引用映射
+    const QString target = QFileInfo(filePath).canonicalFilePath();
+    if (!target.isEmpty()) {
+        std::function<void(QGraphicsItem *)> detach = [&](QGraphicsItem *item) {
+            auto *img = dynamic_cast<LayoutEditorItem *>(item);
+            std::shared_ptr<BinaryLayout::Reader> reader = img ? img->embeddedReader() : nullptr;
+            if (reader && QFileInfo(reader->fileName()).canonicalFilePath() == target)
+                img->detachEmbeddedBlob();
+            for (QGraphicsItem *child : item->childItems())
+                detach(child);
+        };
+        for (QGraphicsItem *item : items)
+            detach(item);
+        for (QGraphicsItem *item : history->retainedItems())
+            detach(item);
+    }
+
+    for (QGraphicsItem *item : items) {
+        BinaryLayout::Item record;
+        if (!itemRecord(item, &record))
+            continue;
+
+        if (record.type == BinaryLayout::Item::Image && embedImages) {
+            auto it = embedded.constFind(record.content);
+            if (it == embedded.cend() || it.value() < 0) {
+                // 原图片文件已不存在时，使用载入时内嵌的数据
+                QFile source(record.content);
+                QByteArray data = static_cast<LayoutEditorItem *>(item)->embeddedData();
+                int blob = -1;
+                if (source.open(QIODevice::ReadOnly))
+                    blob = writer.addBlob(source.readAll());
+                else if (!data.isEmpty())
+                    blob = writer.addBlob(data);
+                it = embedded.insert(record.content, blob);
             }
-        } else if (type == "text") {
-            auto *txt = new TextItem();
-            txt->setPlainText(obj["text"].toString());
-            QFont font;
-            font.setPointSize(obj["fontSize"].toInt());
-            font.setBold(obj["fontBold"].toBool());
-            font.setFamily(obj["fontFamily"].toString());
-            txt->setFont(font);
-            txt->setFlags(QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemIsFocusable);
-            scene->addItem(txt);
-            txt->setPos(obj["x"].toDouble(), obj["y"].toDouble());
+            record.blob = it.value();
         }
+
+        writer.addItem(record);
     }
+
+    return writer.save(filePath);
+}
+
+bool LayoutEditor::loadFromBinary(const QString &filePath)
+{
+    TraceSpan span("loadFromBinary", "load");
+    auto reader = std::make_shared<BinaryLayout::Reader>();
+    if (!reader->open(filePath))
+        return false;
+
+    cancelLoad();
+    resetScene();
+
+    const int count = reader->itemCount();
+    for (int i = 0; i < count; ++i)
+        addRecord(reader->item(i), reader);
+    return true;
+}
+
+void LayoutEditor::setAutosavePath(const QString &basePath)
+{
+    autosave.setBasePath(basePath);
+}
+
+void LayoutEditor::setAutosaveEnabled(bool enabled)
+{
+    if (enabled)
+        autosaveTimer->start();
+    else
+        autosaveTimer->stop();
+}
+
+bool LayoutEditor::restoreAutosave()
+{
+    TraceSpan span("restoreAutosave", "load");
+    QVector<LayoutRecord> records;
+    if (!autosave.restore(&records))
+        return false;
+
+    cancelLoad();
+    resetScene();
+    for (const LayoutRecord &record : std::as_const(records))
+        addRecord(record);
+    autosave.compact(scene->items(Qt::AscendingOrder));  // 以恢复后的场景作为新的快照
+    return true;
+}
+
+void LayoutEditor::autosaveTick()
+{
+    TraceSpan span("autosave", "save");
+    if (isLoading())
+        return;  // 载入完成后再整体写快照
+    // 平时只追加变化，代价与变化数量成正比；日志过长时才重写快照
+    if (autosave.needsCompaction())
+        autosave.compact(scene->items(Qt::AscendingOrder));
+    else
+        autosave.flush();
 }
@@ -4,11 +4,36 @@
 #include <QGraphicsView>
 #include <QGraphicsScene>
 #include <QGraphicsPixmapItem>
+#include <QSet>
+#include <functional>
+#include <memory>
+#include "snapindex.h"
+#include "itemindex.h"
+#include "layoutrecord.h"
+#include "autosavejournal.h"
+#include "undohistory.h"
+#include "htmlexporter.h"
+
+class QRubberBand;
+class QTimer;
+class LayoutEditorItem;
+class TextItem;
+class CarouselClock;
+class FrameDiagnostics;
+template <typename T> class QFutureWatcher;
+namespace BinaryLayout { class Reader; }
 
 class LayoutEditor : public QGraphicsView
 {
     Q_OBJECT
 public:
+    // 点击命中与框选使用的索引方式，可通过环境变量 HTMLEDITOR_INDEX=rtree|bsp|none 指定
+    enum IndexMode {
+        RTreeIndex,   // 编辑器的查询和框选用 R 树，Qt 的事件分发用 BSP
+        BspIndex,     // Qt 自带的 BSP 索引
+        NoSceneIndex  // 线性扫描
+    };
+
     explicit LayoutEditor(QWidget *parent = nullptr);
     void addImageItem(const QString &filePath);
     void addTextItem(const QString &text);
@@ -19,14 +44,141 @@ public:
     QGraphicsItem *draggingItem = nullptr;
     QPoint lastMousePos;
     void saveToJson(const QString &filePath);
+    // 异步读取：工作线程解析文档，GUI 线程分批插入图形项，期间视图可正常操作
     void loadFromJson(const QString &filePath);
+    bool isLoading() const;
+    // 二进制项目格式，可选把图片文件内嵌；读取时图片进入视口后才解码
+    bool saveToBinary(const QString &filePath, bool embedImages = false);
+    bool loadFromBinary(const QString &filePath);
+
+    // 图形项几何变化时由图形项自身通知，用于维护吸附索引
+    static LayoutEditor *fromScene(const QGraphicsScene *scene);
+    static void trackItemChange(QGraphicsItem *item, QGraphicsItem::GraphicsItemChange change);
+    void itemGeometryChanged(QGraphicsItem *item);
+    void itemRemoved(QGraphicsItem *item);
+    void itemContentChanged(QGraphicsItem *item);  // 文字或样式变化，只影响自动保存
+    static bool itemRecord(const QGraphicsItem *item, LayoutRecord *record);
+
+    // 批量修改：作用域内的移动、删除、样式修改共用一次索引更新和一次重绘，可嵌套
+    class Transaction
+    {
+    public:
+        explicit Transaction(LayoutEditor *editor) : editor(editor) { editor->beginTransaction(); }
+        ~Transaction() { editor->endTransaction(); }
+        Transaction(const Transaction &) = delete;
+        Transaction &operator=(const Transaction &) = delete;
+
+    private:
+        LayoutEditor *editor;
+    };
+
+    // 删除会进入撤销历史；选中的组合只解散，不删除其中的图形项
+    void deleteItems(const QList<QGraphicsItem *> &items);
+    void moveItems(const QList<QGraphicsItem *> &items, const QPointF &offset);  // 可撤销
+    void applyTextStyle(const std::function<void(TextItem *)> &change);  // 作用于选中的全部文字项
+    void recordResize(LayoutEditorItem *item, const QSizeF &from, const QSizeF &to);
+
+    // 自动保存的文件放在 basePath 旁边，见 AutosaveJournal
+    void setAutosavePath(const QString &basePath);
+    bool restoreAutosave();
+
+    // 记录载入编辑器（addRecord）后再导出时的快照，不创建场景；与 addRecord 共用同一组规则，
+    // 批量导出据此保证输出与 generateHTML 一致
+    struct TextDefaults {
+        int pointSize = 0;
+        QRgb color = 0xff000000;
+    };
+    static TextDefaults textDefaults();  // 新建文字项的默认字号和颜色，只能在 GUI 线程调用
+    // 按 scene->items() 的顺序输出；imageSize 返回图片的像素尺寸，无效时图片在编辑器中会被移除。
+    // 可在工作线程中调用
+    static void snapshotRecords(const QVector<LayoutRecord> &records, const TextDefaults &defaults,
+                                const std::function<QSize(const QString &)> &imageSize,
+                                QVector<HtmlExporter::ItemSnapshot> *out);
+
+    IndexMode indexMode() const;
+    void setIndexMode(IndexMode mode);
+    QGraphicsItem *hitItem(const QPointF &scenePos);  // 与 QGraphicsScene::itemAt 语义一致
+    CarouselClock *carouselClock() const;
+
+signals:
+    void loadProgress(int done, int total);
+    void loadFinished(bool ok);  // 出错或被取消时 ok 为 false，已插入的图形项保留
+
+public slots:
+    void cancelLoad();
+    void setAutosaveEnabled(bool enabled);
+    void undo();
+    void redo();
+    void setDiagnosticsVisible(bool visible);  // 帧时间与输入延迟浮层
 
 private:
+    friend class LayoutEditorBenchmark;  // benchmarks/ 直接测量 trySnap、drawBackground 等内部路径
+
     QGraphicsScene *scene;
     int snapThreshold = 5;
     QPointF trySnap(QGraphicsItem *movingItem, QPointF newPos);
+    // 对齐线变化时只重绘新旧两条线所在的细条
+    void setSnapLines(const QPointF &vertical, const QPointF &horizontal);
+    void updateSnapLineStrip(const QPointF &line, Qt::Orientation orientation);
+
+    SnapIndex snapIndex;
+    ItemIndex itemIndex;
+    QSet<QGraphicsItem *> pendingIndexItems;  // 位置已变化、尚未写入索引的图形项
+    void flushIndexes(const QGraphicsItem *skip = nullptr);
+
+    void beginTransaction();
+    void endTransaction();
+    int transactionDepth = 0;
+    QSet<QGraphicsItem *> transactionRemoved;  // 事务结束时一次性移出吸附索引
+    // 事务期间各图形项的脏区域只合并外接矩形，场景处理完后恢复原来的更新方式
+    bool updateModePending = false;
+    QGraphicsView::ViewportUpdateMode updateModeBeforeTransaction = MinimalViewportUpdate;
+    void restoreUpdateMode();
+
+    // 按住方向键时自动重复的位移累加起来，每帧只移动一次
+    static const int NudgeIntervalMs = 16;
+    QTimer *nudgeTimer;
+    QPointF pendingNudge;
+    void flushNudge();
+    void resetScene();
+    void finishImageLoad(LayoutEditorItem *item, const QPixmap &pixmap);
+    void addRecord(const LayoutRecord &record, const std::shared_ptr<BinaryLayout::Reader> &reader = nullptr);
+    static const QGraphicsItem::GraphicsItemFlags RecordImageFlags;
+    static const QGraphicsItem::GraphicsItemFlags RecordTextFlags;
+    static int recordPointSize(const LayoutRecord &record, int defaultSize);  // 字号无效时 QFont 保留默认字号
+
+    // 分批载入：每批不超过 LoadSliceMs，批次之间回到事件循环
+    struct ParsedLayout {
+        bool ok = false;
+        QVector<LayoutRecord> records;
+    };
+    static const int LoadSliceMs = 8;
+    QFutureWatcher<ParsedLayout> *parseWatcher = nullptr;
+    QTimer *loadTimer;
+    QVector<LayoutRecord> loadRecords;
+    int loadNext = 0;
+    void startInsert(const ParsedLayout &parsed);
+    void insertNextBatch();
+    void stopLoad();
+
+    static const int AutosaveIntervalMs = 5000;
+    AutosaveJournal autosave;
+    QTimer *autosaveTimer;
+    void autosaveTick();
+
+    std::unique_ptr<UndoHistory> history;
+    QVector<UndoHistory::Move> dragMoves;  // 按下鼠标时选中项的位置，松开后记入历史
+
+    IndexMode currentIndexMode = RTreeIndex;
+    CarouselClock *clock;
+    QRubberBand *rubberBand = nullptr;
+    QPoint rubberOrigin;
+    bool rubberSelecting = false;
+    QSet<QGraphicsItem *> marqueeSelection;  // 本次框选新选中的图形项
+    void updateMarqueeSelection();
 
 protected:
+    void paintEvent(QPaintEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void drawForeground(QPainter *painter, const QRectF &rect) override;
     void keyPressEvent(QKeyEvent *event) override;
@@ -50,6 +202,19 @@ public slots:
 
 protected:
     void drawBackground(QPainter *painter, const QRectF &rect) override;
+
+private:
+    // 网格缓存为一块平铺图，只在网格间距、视图缩放或屏幕像素比变化时重建
+    QPixmap gridTile;
+    int gridTileStep = 0;
+    qreal gridTileScale = 0;
+    qreal gridTileRatio = 0;
+    void rebuildGridTile(int step, qreal scale, qreal ratio);
+    void drawGrid(QPainter *painter, const QRectF &rect);
+
+    std::unique_ptr<FrameDiagnostics> diagnostics;  // 浮层关闭时为空
+    QGraphicsView::ViewportUpdateMode updateModeBeforeDiagnostics = MinimalViewportUpdate;
+    void drawDiagnostics(QPainter *painter);
 };
 
 #endif // LAYOUTEDITOR_H
@@ -1,19 +1,146 @@
 #include "layouteditoritem.h"
 #include "resizehandleitem.h"
+#include "layouteditor.h"
+#include "binarylayout.h"
 #include <QGraphicsSceneContextMenuEvent>
 #include <QMenu>
 #include <QGraphicsScene>
+#include <QPainter>
 #include <QtMath>
+#include "imageloader.h"
+#include "tracer.h"
 
 
 LayoutEditorItem::LayoutEditorItem(const QPixmap &pix, const QString &src, QGraphicsItem *parent)
     : QGraphicsPixmapItem(pix, parent), filePath(src),originalPixmap(pix)
 {
     setPixmap(pix);
+    setFlag(ItemSendsGeometryChanges);  // 位置变化时通知编辑器更新吸附索引
      resizeHandle = new ResizeHandleItem(this);
      resizeHandle->setPos(boundingRect().width() - 5, boundingRect().height() - 5);
 }
 
+LayoutEditorItem::LayoutEditorItem(const QString &src, const QSizeF &placeholderSize, QGraphicsItem *parent)
+    : QGraphicsPixmapItem(parent), filePath(src), loading(true), placeholder(placeholderSize)
+{
+    setFlag(ItemSendsGeometryChanges);
+    resizeHandle = new ResizeHandleItem(this);
+    updateHandle();
+}
+
+LayoutEditorItem::~LayoutEditorItem()
+{
+    if (loading || previewing)
+        ImageLoader::instance()->cancel(this);  // 图形项已删除，丢弃尚未完成的解码或缩放
+}
+
+bool LayoutEditorItem::isLoading() const
+{
+    return loading;
+}
+
+void LayoutEditorItem::setDeferredLoader(std::function<void()> loader)
+{
+    deferredLoader = std::move(loader);
+}
+
+void LayoutEditorItem::setEmbeddedBlob(const std::shared_ptr<BinaryLayout::Reader> &reader, int index)
+{
+    blobReader = reader;
+    blobData = reader ? reader->blob(index) : QByteArray();
+    blobKey = reader ? reader->blobKey(index) : QByteArray();
+}
+
+QByteArray LayoutEditorItem::embeddedData() const
+{
+    return blobData;
+}
+
+QByteArray LayoutEditorItem::embeddedKey() const
+{
+    return blobKey;
+}
+
+std::shared_ptr<BinaryLayout::Reader> LayoutEditorItem::embeddedReader() const
+{
+    return blobReader;
+}
+
+void LayoutEditorItem::detachEmbeddedBlob()
+{
+    if (!blobReader)
+        return;
+    blobData = QByteArray(blobData.constData(), blobData.size());  // fromRawData 只有深复制才脱离映射
+    blobReader.reset();
+}
+
+void LayoutEditorItem::setImage(const QPixmap &pixmap)
+{
+    prepareGeometryChange();
+    loading = false;
+    originalPixmap = pixmap;
+    setPixmap(originalPixmap);
+    updateHandle();
+
+    if (auto *editor = LayoutEditor::fromScene(scene()))
+        editor->itemGeometryChanged(this);
+}
+
+void LayoutEditorItem::updateHandle()
+{
+    if (resizeHandle)
+        resizeHandle->setPos(boundingRect().width() - 5, boundingRect().height() - 5);
+}
+
+QRectF LayoutEditorItem::boundingRect() const
+{
+    if (loading)
+        return QRectF(QPointF(0, 0), placeholder);
+    if (previewing)
+        return QRectF(QPointF(0, 0), previewSize);
+    if (pixmap().isNull())
+        return QRectF();
+    return imageBounds(pixmap().deviceIndependentSize(), flags().testFlag(ItemIsSelectable)).translated(offset());
+}
+
+QRectF LayoutEditorItem::imageBounds(const QSizeF &imageSize, bool selectable)
+{
+    QRectF rect(QPointF(0, 0), imageSize);
+    return selectable ? rect.adjusted(-0.5, -0.5, 0.5, 0.5) : rect;
+}
+
+QPainterPath LayoutEditorItem::shape() const
+{
+    if (loading || previewing) {
+        QPainterPath path;
+        path.addRect(boundingRect());
+        return path;
+    }
+    return QGraphicsPixmapItem::shape();
+}
+
+void LayoutEditorItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    if (previewing) {
+        // 由画笔变换拉伸低分辨率副本，不生成新的像素
+        painter->drawPixmap(boundingRect(), proxyPixmap, proxyPixmap.rect());
+        return;
+    }
+    if (!loading) {
+        QGraphicsPixmapItem::paint(painter, option, widget);
+        return;
+    }
+    if (deferredLoader) {
+        std::function<void()> loader = std::move(deferredLoader);
+        deferredLoader = nullptr;
+        loader();
+    }
+    // 占位框：浅灰底色加虚线边框
+    painter->fillRect(boundingRect(), QColor(240, 240, 240));
+    painter->setPen(QPen(Qt::gray, 1, Qt::DashLine));
+    painter->drawRect(boundingRect());
+}
+
 QString LayoutEditorItem::source() const
 {
     return filePath;
@@ -25,8 +152,12 @@ void LayoutEditorItem::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
     QAction *deleteAction = menu.addAction("删除");
     QAction *selectedAction = menu.exec(event->screenPos());
     if (selectedAction == deleteAction) {
-        scene()->removeItem(this);
-        delete this;
+        if (auto *editor = LayoutEditor::fromScene(scene())) {
+            editor->deleteItems({ this });  // 可撤销
+        } else {
+            scene()->removeItem(this);
+            delete this;
+        }
     }
 }
 
@@ -42,6 +173,78 @@ void LayoutEditorItem::resizeTo(const QSizeF &newSize)
         resizeHandle->setPos(boundingRect().width() -5, boundingRect().height() - 5);
     if (!resizeHandle)
         return;
+
+    if (auto *editor = LayoutEditor::fromScene(scene()))
+        editor->itemGeometryChanged(this);
+}
+
+void LayoutEditorItem::beginResize()
+{
+    if (originalPixmap.isNull())
+        return;
+
+    // 代理图最长边不超过 1024，拖动时的绘制代价与原图分辨率无关
+    const QSize proxyLimit(1024, 1024);
+    if (!previewing) {
+        proxyPixmap = originalPixmap.width() > proxyLimit.width() || originalPixmap.height() > proxyLimit.height()
+                          ? originalPixmap.scaled(proxyLimit, Qt::KeepAspectRatio, Qt::FastTransformation)
+                          : originalPixmap;
+    }
+    ImageLoader::instance()->cancel(this);  // 上一次松开后的缩放尚未完成时直接放弃
+    prepareGeometryChange();
+    previewSize = boundingRect().size();
+    previewing = true;
+}
+
+void LayoutEditorItem::previewResize(const QSizeF &newSize)
+{
+    if (!previewing)
+        return;
+
+    prepareGeometryChange();
+    previewSize = QSizeF(originalPixmap.size().scaled(newSize.toSize(), Qt::KeepAspectRatio));
+    updateHandle();
+
+    if (auto *editor = LayoutEditor::fromScene(scene()))
+        editor->itemGeometryChanged(this);
+}
+
+void LayoutEditorItem::finishResize(const QSizeF &newSize)
+{
+    TraceSpan span("finishResize", "resize");
+    if (!previewing)
+        return;
+
+    previewResize(newSize);
+    if (previewSize.toSize() == pixmap().size()) {
+        // 尺寸没有变化（只是点了一下手柄），直接结束预览
+        prepareGeometryChange();
+        previewing = false;
+        proxyPixmap = QPixmap();
+        updateHandle();
+        return;
+    }
+    // 结果返回前继续显示预览
+    ImageLoader::instance()->scale(this, originalPixmap.toImage(), previewSize.toSize(),
+                                   [this](const QPixmap &scaled) {
+        prepareGeometryChange();
+        previewing = false;
+        proxyPixmap = QPixmap();
+        setPixmap(scaled);
+        updateHandle();
+        if (auto *editor = LayoutEditor::fromScene(scene()))
+            editor->itemGeometryChanged(this);
+    });
+}
+
+QVariant LayoutEditorItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    // 外部 setFlags 覆盖标志位时保留位置变化通知
+    if (change == ItemFlagsChange)
+        return QVariant(value.toUInt() | ItemSendsGeometryChanges);
+
+    LayoutEditor::trackItemChange(this, change);
+    return QGraphicsPixmapItem::itemChange(change, value);
 }
 
 
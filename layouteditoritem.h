@@ -3,23 +3,64 @@
 
 #include <QGraphicsPixmapItem>
 #include <QPixmap>
+#include <functional>
+#include <memory>
 #include "resizehandleitem.h"
 
+namespace BinaryLayout { class Reader; }
+
 class LayoutEditorItem : public QGraphicsPixmapItem
 {
 public:
     LayoutEditorItem(const QPixmap &pix, const QString &src, QGraphicsItem *parent = nullptr);
+    // 异步加载：先显示指定大小的占位框，图片解码完成后调用 setImage
+    LayoutEditorItem(const QString &src, const QSizeF &placeholderSize, QGraphicsItem *parent = nullptr);
+    ~LayoutEditorItem();
     QString source() const;
     void resizeTo(const QSizeF &newSize);  //缩放图片函数
+    // 拖动缩放手柄：拖动中只显示低分辨率预览，松开后在后台做一次高质量缩放
+    void beginResize();
+    void previewResize(const QSizeF &newSize);
+    void finishResize(const QSizeF &newSize);
+    void setImage(const QPixmap &pixmap);  // 原图与缓存共享，不复制像素
+    bool isLoading() const;
+    // 延迟加载：占位框第一次被绘制（即进入视口）时才调用 loader 开始读取图片
+    void setDeferredLoader(std::function<void()> loader);
+    // 项目文件内嵌的图片：数据指向 reader 的映射，图形项持有 reader 使映射保持有效。
+    // 原图片文件不存在时，再次保存仍可写出这份数据
+    void setEmbeddedBlob(const std::shared_ptr<BinaryLayout::Reader> &reader, int index);
+    QByteArray embeddedData() const;  // 没有内嵌数据时为空
+    QByteArray embeddedKey() const;
+    std::shared_ptr<BinaryLayout::Reader> embeddedReader() const;  // 已复制出数据时为空
+    void detachEmbeddedBlob();  // 把数据复制到自有内存，不再引用映射
+
+    // 已载入图片的边界：可选中时向外扩半个像素（选中边框的画笔宽度），与 QGraphicsPixmapItem 相同。
+    // 批量导出不创建图形项，也用它计算图片位置
+    static QRectF imageBounds(const QSizeF &imageSize, bool selectable);
+
+    QRectF boundingRect() const override;
+    QPainterPath shape() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
 
 private:
     QString filePath; // 保存图片路径
-    ResizeHandleItem *resizeHandle;
+    ResizeHandleItem *resizeHandle = nullptr;
     QPixmap originalPixmap;
     QPointF dragOffset; // 鼠标点击时相对于左上角的偏移
+    bool loading = false;
+    QSizeF placeholder;  // 加载期间的占位尺寸
+    bool previewing = false;
+    QSizeF previewSize;
+    QPixmap proxyPixmap;  // 缩放预览用的低分辨率副本
+    std::function<void()> deferredLoader;
+    std::shared_ptr<BinaryLayout::Reader> blobReader;
+    QByteArray blobData;
+    QByteArray blobKey;
+    void updateHandle();
 
 protected:
     void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
 
 
 };
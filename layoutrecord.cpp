@@ -0,0 +1,46 @@
+#include "layoutrecord.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+bool parseLayoutJson(const QByteArray &json, QVector<LayoutRecord> *records, QString *error)
+{
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &parseError);
+    if (doc.isNull()) {
+        if (error)
+            *error = parseError.errorString();
+        return false;
+    }
+    if (!doc.isObject() || !doc.object()["items"].isArray()) {
+        if (error)
+            *error = "missing \"items\" array";
+        return false;
+    }
+
+    const QJsonArray items = doc.object()["items"].toArray();
+    records->clear();
+    records->reserve(items.size());
+    for (const QJsonValue &val : items) {
+        QJsonObject obj = val.toObject();
+        QString type = obj["type"].toString();
+
+        LayoutRecord record;
+        record.pos = QPointF(obj["x"].toDouble(), obj["y"].toDouble());
+        if (type == "image") {
+            record.type = LayoutRecord::Image;
+            record.content = obj["source"].toString();
+            record.size = QSizeF(obj["width"].toDouble(), obj["height"].toDouble());
+        } else if (type == "text") {
+            record.type = LayoutRecord::Text;
+            record.content = obj["text"].toString();
+            record.fontSize = obj["fontSize"].toInt();
+            record.bold = obj["fontBold"].toBool();
+            record.fontFamily = obj["fontFamily"].toString();
+        } else {
+            continue;
+        }
+        records->append(record);
+    }
+    return true;
+}
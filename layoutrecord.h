@@ -0,0 +1,33 @@
+#ifndef LAYOUTRECORD_H
+#define LAYOUTRECORD_H
+
+#include <QColor>
+#include <QPointF>
+#include <QSizeF>
+#include <QString>
+#include <QVector>
+
+// 与场景无关的图形项数据，JSON 与二进制项目文件读写都先转换为它
+struct LayoutRecord {
+    enum Type : quint8 {
+        Image = 1,
+        Text = 2
+    };
+
+    Type type = Image;
+    QPointF pos;
+    QSizeF size;
+    QString content;      // 图片路径或纯文本
+    QString fontFamily;
+    int fontSize = 0;
+    bool bold = false;
+    bool hasColor = false;  // JSON 格式不保存文字颜色
+    QRgb color = 0xff000000;
+    int blob = -1;        // 二进制文件中内嵌图片的下标，-1 表示未内嵌
+};
+
+// 解析 saveToJson 写出的文档，可在工作线程中调用；
+// 类型未知的条目会被跳过，文档本身无效时返回 false
+bool parseLayoutJson(const QByteArray &json, QVector<LayoutRecord> *records, QString *error = nullptr);
+
+#endif // LAYOUTRECORD_H
@@ -1,10 +1,24 @@
 #include <QApplication>
 #include "mainwindow.h"
+#include "batchconverter.h"
+#include "tracer.h"
 
 int main(int argc, char *argv[])
 {
+    // HTMLEDITOR_TRACE=<文件> 或 --trace <文件>：退出时写出 Chrome trace
+    Tracer::startFromArguments(argc, argv);
+
+    // 命令行批量导出，不创建任何窗口
+    if (BatchConverter::isRequested(argc, argv)) {
+        int code = BatchConverter::run(argc, argv);
+        Tracer::finish();
+        return code;
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
-    return a.exec();
+    int code = a.exec();
+    Tracer::finish();
+    return code;
 }
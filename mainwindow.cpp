@@ -1,14 +1,87 @@
 #include "mainwindow.h"
 #include "layouteditor.h"
 #include "textitem.h"
+#include "htmlexporter.h"
+#include "responsiveimages.h"
+#include "assetbundle.h"
+#include <QApplication>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QMessageBox>
-#include <QTextStream>
+#include <QFile>
 #include <QMenuBar>
 #include <QMenu>
 #include <QAction>
 #include <QGraphicsScene>
 #include <QLabel>
+#include <QActionGroup>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QStatusBar>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+struct ExportResult {
+    bool ok = false;
+    QString summary;  // 追加在完成提示后面的统计信息
+};
+
+// 在工作线程中执行，只使用快照，不访问场景
+ExportResult writePage(const QString &filePath, const QVector<HtmlExporter::ItemSnapshot> &snapshots,
+                       AssetBundle *bundle, bool responsive, int fold)
+{
+    ExportResult result;
+
+    // 图片变体默认放在与页面同名的目录中，逐张的大小对比写入其中的 report.tsv；
+    // 打包导出时变体交给 bundle，对比报告放在页面旁边
+    QFileInfo info(filePath);
+    ResponsiveImages images(info.path(), info.completeBaseName() + "_images");
+    if (responsive) {
+        images.setBundle(bundle);
+        for (const HtmlExporter::ItemSnapshot &item : snapshots)
+            images.add(item);
+        bool allEncoded = images.build();
+
+        QString report = images.report();
+        QString reportPath = bundle ? info.path() + "/" + info.completeBaseName() + "-images.tsv"
+                                    : info.path() + "/" + info.completeBaseName() + "_images/report.tsv";
+        QFile reportFile(reportPath);
+        if (reportFile.open(QIODevice::WriteOnly | QIODevice::Text))
+            reportFile.write(report.toUtf8());
+        result.summary += "\n" + report.section('\n', -2, -2);  // 合计行
+        if (!allEncoded)
+            result.summary += "\nSome images could not be re-encoded; their original files are used.";
+    }
+    if (bundle) {
+        // 只打包页面实际引用的原图：已经重新编码的图片不再复制原图
+        HtmlExporter::ImageRef ref;
+        for (const HtmlExporter::ItemSnapshot &item : snapshots) {
+            if (item.kind == HtmlExporter::ItemSnapshot::Image && !(responsive && images.resolve(item, &ref)))
+                bundle->add(item.content);
+        }
+        if (!bundle->build())
+            result.summary += "\n" + bundle->errors().join("\n");
+        bundle->prune();
+        result.summary += QString("\n%1 asset files, %2 inlined.").arg(bundle->fileCount()).arg(bundle->inlineCount());
+    }
+
+    HtmlExporter exporter;
+    exporter.setImageResolver([&](const HtmlExporter::ItemSnapshot &item, HtmlExporter::ImageRef *ref) {
+        return (responsive && images.resolve(item, ref)) || (bundle && bundle->resolve(item, ref));
+    });
+    exporter.setLoadingHints(fold);
+
+    // 分块直接写入文件，不在内存中拼接整页
+    QFile file(filePath);
+    result.ok = file.open(QIODevice::WriteOnly | QIODevice::Text) && exporter.exportTo(&file, snapshots);
+    file.close();
+    return result;
+}
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -23,6 +96,7 @@ MainWindow::MainWindow(QWidget *parent)
 
     // 创建菜单项
     QMenu *fileMenu = menuBar->addMenu("文件");
+    QMenu *editMenu = menuBar->addMenu("编辑");
     QMenu *insertMenu = menuBar->addMenu("插入");
     QMenu *viewMenu = menuBar->addMenu("视图");
 
@@ -36,6 +110,35 @@ MainWindow::MainWindow(QWidget *parent)
     fileMenu->addAction(exportHtmlAction);
     insertMenu->addAction(insertTextAction);
 
+    QAction *exportBundleAction = new QAction("导出为独立文件夹", this);
+    fileMenu->addAction(exportBundleAction);
+    connect(exportBundleAction, &QAction::triggered, this, &MainWindow::exportBundle);
+
+    // 导出时按显示尺寸重新编码图片，生成 srcset
+    responsiveImagesAction = new QAction("导出时生成响应式图片", this);
+    responsiveImagesAction->setCheckable(true);
+    responsiveImagesAction->setChecked(QSettings("htmleditor", "htmleditor").value("export/responsiveImages", false).toBool());
+    fileMenu->addAction(responsiveImagesAction);
+    connect(responsiveImagesAction, &QAction::toggled, this, [](bool checked) {
+        QSettings("htmleditor", "htmleditor").setValue("export/responsiveImages", checked);
+    });
+
+    // 元素按纵向位置输出，首屏以上的图片优先加载，其余延迟加载；首屏高度见 export/foldY
+    loadingHintsAction = new QAction("导出时按位置排序并添加加载提示", this);
+    loadingHintsAction->setCheckable(true);
+    loadingHintsAction->setChecked(QSettings("htmleditor", "htmleditor").value("export/loadingHints", false).toBool());
+    fileMenu->addAction(loadingHintsAction);
+    connect(loadingHintsAction, &QAction::toggled, this, [](bool checked) {
+        QSettings("htmleditor", "htmleditor").setValue("export/loadingHints", checked);
+    });
+
+    QAction *undoAction = editMenu->addAction("撤销");
+    undoAction->setShortcut(QKeySequence::Undo);
+    connect(undoAction, &QAction::triggered, editor, &LayoutEditor::undo);
+    QAction *redoAction = editMenu->addAction("重做");
+    redoAction->setShortcut(QKeySequence::Redo);
+    connect(redoAction, &QAction::triggered, editor, &LayoutEditor::redo);
+
     // 连接动作到槽函数
     connect(insertImageAction, &QAction::triggered, this, &MainWindow::on_actionInsertImage_triggered);
     connect(exportHtmlAction, &QAction::triggered, this, &MainWindow::on_actionExportHTML_triggered);
@@ -82,48 +185,39 @@ MainWindow::MainWindow(QWidget *parent)
     posYBox->setRange(0, 5000);
     styleToolbar->addWidget(posYBox);
 
+    // 样式修改作用于选中的全部文字项，合并为一次重绘
     connect(fontSizeBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [=](int size) {
-        auto items = editor->getScene()->selectedItems();
-        if (!items.isEmpty()) {
-            auto *textItem = qgraphicsitem_cast<TextItem *>(items.first());
-            if (textItem) {
-                QFont font = textItem->font();
-                font.setPointSize(size);
-                textItem->setFont(font);
-            }
-        }
+        editor->applyTextStyle([size](TextItem *textItem) {
+            QFont font = textItem->font();
+            font.setPointSize(size);
+            textItem->setFont(font);
+        });
     });
 
     connect(fontCombo, &QFontComboBox::currentFontChanged, this, [=](const QFont &f) {
-        auto items = editor->getScene()->selectedItems();
-        if (!items.isEmpty()) {
-            auto *textItem = qgraphicsitem_cast<TextItem *>(items.first());
-            if (textItem) {
-                QFont font = textItem->font();
-                font.setFamily(f.family());
-                textItem->setFont(font);
-            }
-        }
+        editor->applyTextStyle([&f](TextItem *textItem) {
+            QFont font = textItem->font();
+            font.setFamily(f.family());
+            textItem->setFont(font);
+        });
     });
 
     connect(boldButton, &QToolButton::toggled, this, [=](bool checked) {
-        auto items = editor->getScene()->selectedItems();
-        if (!items.isEmpty()) {
-            auto *textItem = qgraphicsitem_cast<TextItem *>(items.first());
-            if (textItem) {
-                QFont font = textItem->font();
-                font.setBold(checked);
-                textItem->setFont(font);
-            }
-        }
+        editor->applyTextStyle([checked](TextItem *textItem) {
+            QFont font = textItem->font();
+            font.setBold(checked);
+            textItem->setFont(font);
+        });
     });
 
     connect(colorButton, &QToolButton::clicked, this, [=]() {
         auto *textItem = qgraphicsitem_cast<TextItem *>(editor->getScene()->focusItem());
         if (textItem) {
             QColor color = QColorDialog::getColor(textItem->defaultTextColor(), this, "Choose Font Color");
-            if (color.isValid())
+            if (color.isValid()) {
                 textItem->setDefaultTextColor(color);
+                editor->itemContentChanged(textItem);
+            }
         }
     });
 
@@ -133,10 +227,17 @@ MainWindow::MainWindow(QWidget *parent)
         if (!items.isEmpty()) {
             auto *textItem = qgraphicsitem_cast<TextItem *>(items.first());
             if (textItem) {
+                // 只同步面板显示，不能反过来把第一项的样式套到整个选区
                 QFont font = textItem->font();
+                fontCombo->blockSignals(true);
+                fontSizeBox->blockSignals(true);
+                boldButton->blockSignals(true);
                 fontCombo->setCurrentFont(font);
                 fontSizeBox->setValue(font.pointSize());
                 boldButton->setChecked(font.bold());
+                fontCombo->blockSignals(false);
+                fontSizeBox->blockSignals(false);
+                boldButton->blockSignals(false);
             }
         }
     });
@@ -155,11 +256,12 @@ MainWindow::MainWindow(QWidget *parent)
         }
     });
 
+    // 经由 moveItems 移动：组合没有位置变化通知，需要编辑器登记到索引和自动保存，同时可撤销
     connect(posXBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [=](int x) {
         auto items = editor->getScene()->selectedItems();
         if (!items.isEmpty()) {
             QGraphicsItem *item = items.first();
-            item->setPos(x, posYBox->value());
+            editor->moveItems({ item }, QPointF(x, posYBox->value()) - item->pos());
         }
     });
 
@@ -167,7 +269,7 @@ MainWindow::MainWindow(QWidget *parent)
         auto items = editor->getScene()->selectedItems();
         if (!items.isEmpty()) {
             QGraphicsItem *item = items.first();
-            item->setPos(posXBox->value(), y);
+            editor->moveItems({ item }, QPointF(posXBox->value(), y) - item->pos());
         }
     });
 
@@ -184,6 +286,52 @@ MainWindow::MainWindow(QWidget *parent)
     viewMenu->addAction(toggleSnapAction);
     connect(toggleSnapAction, &QAction::triggered, editor, &LayoutEditor::toggleSnapToGrid);
 
+    // 诊断浮层：帧时间、各绘制阶段耗时和输入延迟
+    QAction *diagnosticsAction = new QAction("性能诊断浮层", this);
+    diagnosticsAction->setCheckable(true);
+    viewMenu->addAction(diagnosticsAction);
+    connect(diagnosticsAction, &QAction::toggled, editor, &LayoutEditor::setDiagnosticsVisible);
+
+    // 命中测试/框选索引方式，便于在同一文档上对比性能
+    QMenu *indexMenu = viewMenu->addMenu("索引方式");
+    QActionGroup *indexGroup = new QActionGroup(this);
+    const QList<QPair<QString, LayoutEditor::IndexMode>> indexModes = {
+        { "R 树索引", LayoutEditor::RTreeIndex },
+        { "BSP 索引（Qt）", LayoutEditor::BspIndex },
+        { "无索引", LayoutEditor::NoSceneIndex },
+    };
+    for (const auto &entry : indexModes) {
+        QAction *action = indexMenu->addAction(entry.first);
+        action->setCheckable(true);
+        action->setChecked(editor->indexMode() == entry.second);
+        indexGroup->addAction(action);
+        LayoutEditor::IndexMode mode = entry.second;
+        connect(action, &QAction::triggered, editor, [editor, mode]() {
+            editor->setIndexMode(mode);
+        });
+    }
+
+    // 自动保存：文件放在当前项目旁边，未保存过的项目放在应用数据目录；启动时恢复上次的内容
+    auto useAutosavePath = [editor](const QString &basePath) {
+        editor->setAutosavePath(basePath);
+        QSettings("htmleditor", "htmleditor").setValue("autosave/basePath", basePath);
+    };
+    QString autosaveBase = QSettings("htmleditor", "htmleditor").value("autosave/basePath").toString();
+    if (autosaveBase.isEmpty()) {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QDir().mkpath(dir);
+        autosaveBase = dir + "/untitled";
+    }
+    editor->setAutosavePath(autosaveBase);
+    editor->restoreAutosave();
+    editor->setAutosaveEnabled(true);
+
+    QAction *autosaveAction = new QAction("自动保存", this);
+    autosaveAction->setCheckable(true);
+    autosaveAction->setChecked(true);
+    fileMenu->addAction(autosaveAction);
+    connect(autosaveAction, &QAction::toggled, editor, &LayoutEditor::setAutosaveEnabled);
+
     QAction *saveJsonAction = new QAction("保存为JSON文件", this);
     fileMenu->addAction(saveJsonAction);
 
@@ -192,6 +340,7 @@ MainWindow::MainWindow(QWidget *parent)
         QString path = QFileDialog::getSaveFileName(this, "Save Layout", "", "JSON Files (*.json)");
         if (!path.isEmpty()) {
             editor->saveToJson(path);  // 假设你前面已经实现了 LayoutEditor::saveToJson
+            useAutosavePath(path);
         }
     });
 
@@ -202,9 +351,61 @@ MainWindow::MainWindow(QWidget *parent)
         QString path = QFileDialog::getOpenFileName(this, "Load Layout", "", "JSON Files (*.json)");
         if (!path.isEmpty()) {
             editor->loadFromJson(path);  // 你稍后会实现这个函数
+            useAutosavePath(path);
         }
     });
 
+    // 载入进度显示在状态栏，可随时取消，已载入的部分保留
+    auto *loadProgressBar = new QProgressBar(this);
+    loadProgressBar->setMaximumWidth(240);
+    auto *cancelLoadButton = new QPushButton("取消载入", this);
+    statusBar()->addPermanentWidget(loadProgressBar);
+    statusBar()->addPermanentWidget(cancelLoadButton);
+    loadProgressBar->hide();
+    cancelLoadButton->hide();
+
+    connect(cancelLoadButton, &QPushButton::clicked, editor, &LayoutEditor::cancelLoad);
+    connect(editor, &LayoutEditor::loadProgress, this, [=](int done, int total) {
+        loadProgressBar->setRange(0, total);
+        loadProgressBar->setValue(done);
+        loadProgressBar->show();
+        cancelLoadButton->show();
+    });
+    connect(editor, &LayoutEditor::loadFinished, this, [=](bool ok) {
+        loadProgressBar->hide();
+        cancelLoadButton->hide();
+        statusBar()->showMessage(ok ? "载入完成" : "载入未完成", 3000);
+    });
+
+    // 二进制项目文件：体积小、打开快，图片进入视口后才读取
+    QAction *saveBinaryAction = new QAction("保存为二进制文件", this);
+    QAction *embedImagesAction = new QAction("二进制文件内嵌图片", this);
+    embedImagesAction->setCheckable(true);
+    QAction *loadBinaryAction = new QAction("导入二进制文件", this);
+    fileMenu->addAction(saveBinaryAction);
+    fileMenu->addAction(embedImagesAction);
+    fileMenu->addAction(loadBinaryAction);
+
+    connect(saveBinaryAction, &QAction::triggered, this, [=]() {
+        QString path = QFileDialog::getSaveFileName(this, "Save Layout", "", "Binary Layout (*.hlb)");
+        if (path.isEmpty())
+            return;
+        if (editor->saveToBinary(path, embedImagesAction->isChecked()))
+            useAutosavePath(path);
+        else
+            QMessageBox::warning(this, "Save", "Failed to write layout file.");
+    });
+
+    connect(loadBinaryAction, &QAction::triggered, this, [=]() {
+        QString path = QFileDialog::getOpenFileName(this, "Load Layout", "", "Binary Layout (*.hlb)");
+        if (path.isEmpty())
+            return;
+        if (editor->loadFromBinary(path))
+            useAutosavePath(path);
+        else
+            QMessageBox::warning(this, "Load", "Not a valid layout file.");
+    });
+
 
 
     resize(1920, 1080);
@@ -229,17 +430,77 @@ void MainWindow::on_actionInsertImage_triggered()
 void MainWindow::on_actionExportHTML_triggered()
 {
     QString filePath = QFileDialog::getSaveFileName(this, "Export HTML", "", "HTML Files (*.html)");
-    if (!filePath.isEmpty()) {
-        auto *editor = qobject_cast<LayoutEditor*>(centralWidget());
-        if (editor) {
-            QString html = editor->generateHTML();
-            QFile file(filePath);
-            if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-                QTextStream out(&file);
-                out << html;
-                file.close();
-                QMessageBox::information(this, "Export", "HTML exported successfully.");
-            }
-        }
+    if (!filePath.isEmpty())
+        exportPage(filePath, nullptr);
+}
+
+void MainWindow::exportBundle()
+{
+    // 页面写成 index.html，引用的图片放在同目录的 assets/ 中，整个目录可直接部署
+    QString dir = QFileDialog::getExistingDirectory(this, "Export to Folder");
+    if (dir.isEmpty())
+        return;
+    if (QFileInfo::exists(dir + "/index.html")
+        && QMessageBox::question(this, "Export", dir + "/index.html already exists. Replace it?")
+               != QMessageBox::Yes)
+        return;
+    auto bundle = std::make_shared<AssetBundle>(dir);
+    bundle->setInlineLimit(QSettings("htmleditor", "htmleditor").value("export/inlineLimitBytes", 4096).toLongLong());
+    exportPage(dir + "/index.html", bundle);
+}
+
+void MainWindow::exportPage(const QString &filePath, const std::shared_ptr<AssetBundle> &bundle)
+{
+    auto *editor = qobject_cast<LayoutEditor*>(centralWidget());
+    if (!editor)
+        return;
+    if (exporting) {
+        QMessageBox::information(this, "Export", "An export is already in progress.");
+        return;
+    }
+
+    const bool responsive = responsiveImagesAction->isChecked();
+    const int fold = loadingHintsAction->isChecked()
+                         ? QSettings("htmleditor", "htmleditor").value("export/foldY", 1080).toInt()
+                         : -1;
+
+    // 不需要处理图片时直接从场景分块写出，不复制整页内容
+    if (!responsive && !bundle) {
+        HtmlExporter exporter(editor->getScene());
+        exporter.setLoadingHints(fold);
+        QFile file(filePath);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Text) && exporter.exportTo(&file))
+            QMessageBox::information(this, "Export", "HTML exported successfully.");
+        else
+            QMessageBox::warning(this, "Export", "Failed to write HTML file.");
+        return;
     }
+
+    // 导出的是此刻的场景：快照在 GUI 线程读取，之后的编辑不影响正在进行的导出
+    QVector<HtmlExporter::ItemSnapshot> snapshots;
+    const QList<QGraphicsItem *> items = editor->getScene()->items();
+    snapshots.reserve(items.size());
+    HtmlExporter::ItemSnapshot data;
+    for (QGraphicsItem *item : items) {
+        if (HtmlExporter::snapshot(item, &data))
+            snapshots.append(data);
+    }
+
+    // 重新编码图片、打包和写出页面都在后台线程中进行，编辑器保持响应
+    exporting = true;
+    statusBar()->showMessage("正在导出…");
+    auto *watcher = new QFutureWatcher<ExportResult>(this);
+    connect(watcher, &QFutureWatcher<ExportResult>::finished, this, [this, watcher]() {
+        ExportResult result = watcher->result();
+        watcher->deleteLater();
+        exporting = false;
+        statusBar()->clearMessage();
+        if (result.ok)
+            QMessageBox::information(this, "Export", "HTML exported successfully." + result.summary);
+        else
+            QMessageBox::warning(this, "Export", "Failed to write HTML file.");
+    });
+    watcher->setFuture(QtConcurrent::run([filePath, snapshots, bundle, responsive, fold]() {
+        return writePage(filePath, snapshots, bundle.get(), responsive, fold);
+    }));
 }
@@ -7,6 +7,9 @@
 #include <QSpinBox>
 #include <QColorDialog>
 #include <QToolButton>
+#include <memory>
+
+class AssetBundle;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -23,6 +26,7 @@ public:
 private slots:
     void on_actionInsertImage_triggered();
     void on_actionExportHTML_triggered();
+    void exportBundle();
 
 
 private:
@@ -33,6 +37,11 @@ private:
     QToolButton *colorButton;
     QSpinBox *posXBox;
     QSpinBox *posYBox;
+    QAction *responsiveImagesAction;
+    QAction *loadingHintsAction;
+    bool exporting = false;  // 后台导出进行中
+    // 在后台线程中导出当前场景；bundle 为空时图片保留原路径
+    void exportPage(const QString &filePath, const std::shared_ptr<AssetBundle> &bundle);
 
 
 
@@ -0,0 +1,173 @@
+#include "pixmapcache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+PixmapCache::PixmapCache()
+{
+    // 默认 256MB，可用环境变量 HTMLEDITOR_PIXMAP_CACHE_MB 调整
+    bool ok = false;
+    int megabytes = qEnvironmentVariableIntValue("HTMLEDITOR_PIXMAP_CACHE_MB", &ok);
+    counters.budget = qint64(ok && megabytes > 0 ? megabytes : 256) * 1024 * 1024;
+}
+
+PixmapCache *PixmapCache::instance()
+{
+    static PixmapCache cache;
+    return &cache;
+}
+
+QString PixmapCache::identityKey(const QFileInfo &info)
+{
+    return QString("%1|%2|%3")
+        .arg(info.absoluteFilePath())
+        .arg(info.size())
+        .arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+QByteArray PixmapCache::contentKey(const QByteArray &fileData)
+{
+    return QCryptographicHash::hash(fileData, QCryptographicHash::Sha1);
+}
+
+QByteArray PixmapCache::contentKeyFor(const QString &identity) const
+{
+    QMutexLocker locker(&mutex);
+    return identities.value(identity);
+}
+
+bool PixmapCache::isResident(const QByteArray &contentKey) const
+{
+    QMutexLocker locker(&mutex);
+    return resident.contains(contentKey);
+}
+
+void PixmapCache::mapIdentity(const QString &identity, const QByteArray &contentKey)
+{
+    auto it = identities.find(identity);
+    if (it != identities.end()) {
+        if (it.value() == contentKey)
+            return;
+        auto alias = aliases.find(it.value());
+        if (alias != aliases.end() && alias->remove(identity) && alias->isEmpty())
+            aliases.erase(alias);
+        it.value() = contentKey;
+    } else {
+        identities.insert(identity, contentKey);
+    }
+    aliases[contentKey].insert(identity);
+}
+
+void PixmapCache::touch(Entry &entry, const QByteArray &contentKey)
+{
+    if (entry.lastUse)
+        recency.remove(entry.lastUse);
+    entry.lastUse = ++useCounter;
+    recency.insert(entry.lastUse, contentKey);
+}
+
+QPixmap PixmapCache::insert(const QString &identity, const QByteArray &contentKey, const QImage &image)
+{
+    {
+        QMutexLocker locker(&mutex);
+        mapIdentity(identity, contentKey);
+    }
+
+    auto it = entries.find(contentKey);
+    if (it != entries.end()) {
+        ++counters.hits;  // 另一个请求已经解码并插入了同一内容
+    } else {
+        // 两个请求同时解码同一内容时，只保留先到的一份
+        ++counters.misses;
+        Entry entry;
+        entry.pixmap = QPixmap::fromImage(image);
+        entry.bytes = image.sizeInBytes();
+        it = entries.insert(contentKey, entry);
+        counters.bytesResident += entry.bytes;
+        QMutexLocker locker(&mutex);
+        resident.insert(contentKey);
+    }
+    touch(*it, contentKey);
+    QPixmap pixmap = it->pixmap;
+    evict(contentKey);
+    return pixmap;
+}
+
+QPixmap PixmapCache::find(const QString &identity, const QByteArray &contentKey)
+{
+    auto it = entries.find(contentKey);
+    if (it == entries.end())
+        return QPixmap();  // 已被淘汰，调用方需要重新解码
+
+    ++counters.hits;
+    {
+        QMutexLocker locker(&mutex);
+        mapIdentity(identity, contentKey);
+    }
+    touch(*it, contentKey);
+    return it->pixmap;
+}
+
+void PixmapCache::forget(const QString &identity)
+{
+    QMutexLocker locker(&mutex);
+    auto it = identities.find(identity);
+    if (it == identities.end())
+        return;
+    auto alias = aliases.find(it.value());
+    if (alias != aliases.end()) {
+        alias->remove(identity);
+        if (alias->isEmpty())
+            aliases.erase(alias);
+    }
+    identities.erase(it);
+}
+
+void PixmapCache::setBudget(qint64 bytes)
+{
+    counters.budget = bytes;
+    evict(QByteArray());
+}
+
+void PixmapCache::evict(const QByteArray &keep)
+{
+    // recency 按最近使用时间排序，每淘汰一项的代价与缓存大小无关
+    auto next = recency.begin();
+    while (counters.bytesResident > counters.budget && entries.size() > 1 && next != recency.end()) {
+        if (next.value() == keep) {
+            ++next;
+            continue;
+        }
+        QByteArray key = next.value();
+        next = recency.erase(next);
+        auto victim = entries.find(key);
+
+        // 仍被图形项引用的像素不会释放，只是不再由缓存持有
+        counters.bytesResident -= victim->bytes;
+        entries.erase(victim);
+
+        QMutexLocker locker(&mutex);
+        resident.remove(key);
+        for (const QString &identity : aliases.take(key))
+            identities.remove(identity);
+    }
+}
+
+PixmapCache::Stats PixmapCache::stats() const
+{
+    Stats result = counters;
+    result.entries = entries.size();
+    return result;
+}
+
+void PixmapCache::clear()
+{
+    entries.clear();
+    recency.clear();
+    counters.bytesResident = 0;
+    QMutexLocker locker(&mutex);
+    identities.clear();
+    aliases.clear();
+    resident.clear();
+}
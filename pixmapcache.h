@@ -0,0 +1,66 @@
+#ifndef PIXMAPCACHE_H
+#define PIXMAPCACHE_H
+
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QMutex>
+#include <QPixmap>
+
+class QFileInfo;
+
+// 进程内共享的原图缓存，按文件内容哈希索引：同一张图片无论插入多少次只解码、存储一份。
+// 文件标识（路径 + 大小 + 修改时间）到内容哈希的映射可在工作线程中查询，
+// 像素数据本身只在 GUI 线程访问。超出内存预算时按最近最少使用淘汰
+class PixmapCache
+{
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        qint64 bytesResident = 0;
+        qint64 budget = 0;
+        int entries = 0;
+    };
+
+    static PixmapCache *instance();
+
+    // 以下四个函数线程安全
+    static QString identityKey(const QFileInfo &info);
+    static QByteArray contentKey(const QByteArray &fileData);
+    QByteArray contentKeyFor(const QString &identity) const;  // 未知时返回空
+    bool isResident(const QByteArray &contentKey) const;
+
+    // 以下函数只能在 GUI 线程调用
+    QPixmap insert(const QString &identity, const QByteArray &contentKey, const QImage &image);
+    QPixmap find(const QString &identity, const QByteArray &contentKey);
+    void forget(const QString &identity);
+    void setBudget(qint64 bytes);
+    Stats stats() const;
+    void clear();
+
+private:
+    PixmapCache();
+
+    struct Entry {
+        QPixmap pixmap;
+        qint64 bytes = 0;
+        quint64 lastUse = 0;
+    };
+
+    void evict(const QByteArray &keep);
+    void touch(Entry &entry, const QByteArray &contentKey);
+    void mapIdentity(const QString &identity, const QByteArray &contentKey);  // 调用方持有 mutex
+
+    mutable QMutex mutex;                       // 保护 identities、aliases 与 resident
+    QHash<QString, QByteArray> identities;
+    QHash<QByteArray, QSet<QString>> aliases;   // identities 的反向索引，淘汰时直接找到对应的文件标识
+    QSet<QByteArray> resident;
+
+    QHash<QByteArray, Entry> entries;
+    QMap<quint64, QByteArray> recency;          // lastUse → 内容哈希，最早使用的在最前
+    quint64 useCounter = 0;
+    Stats counters;
+};
+
+#endif // PIXMAPCACHE_H
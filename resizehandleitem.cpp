@@ -1,5 +1,6 @@
 #include "resizehandleitem.h"
 #include "layouteditoritem.h"
+#include "layouteditor.h"
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsScene>
 #include <QBrush>
@@ -18,6 +19,8 @@ void ResizeHandleItem::mousePressEvent(QGraphicsSceneMouseEvent *event)
 {
     dragStart = event->scenePos();
     originalSize = parent->boundingRect().size();
+    currentSize = originalSize;
+    parent->beginResize();
     QGraphicsRectItem::mousePressEvent(event);
 }
 
@@ -29,5 +32,14 @@ void ResizeHandleItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
     if (newSize.width() < 5 || newSize.height() < 5)
         return;
 
-    parent->resizeTo(newSize);
+    currentSize = newSize;
+    parent->previewResize(newSize);  // 拖动中只做预览
+}
+
+void ResizeHandleItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
+{
+    parent->finishResize(currentSize);
+    if (auto *editor = LayoutEditor::fromScene(scene()))
+        editor->recordResize(parent, originalSize, currentSize);
+    QGraphicsRectItem::mouseReleaseEvent(event);
 }
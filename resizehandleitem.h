@@ -13,10 +13,12 @@ public:
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
     void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+    void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
 
 private:
     QPointF dragStart;
     QSizeF originalSize;
+    QSizeF currentSize;
     LayoutEditorItem *parent;
 };
 
@@ -0,0 +1,240 @@
+#include "responsiveimages.h"
+#include "assetbundle.h"
+#include "tracer.h"
+#include <QBuffer>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QUrl>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+// 显示尺寸的倍数；超出原图的部分按原图大小截断
+const int Densities[] = { 1, 2 };
+
+QString sanitizedStem(const QString &path)
+{
+    QString stem = QFileInfo(path).completeBaseName();
+    for (QChar &c : stem) {
+        if (!(c.isLetterOrNumber() && c.unicode() < 128) && c != '-' && c != '_')
+            c = '_';
+    }
+    return stem.isEmpty() ? QString("image") : stem;
+}
+
+// 页面名中的空格、逗号会拆开 srcset 的候选项，每段路径分别做百分号编码
+QString urlPath(const QString &path)
+{
+    if (path.startsWith("data:"))
+        return path;
+    QStringList segments = path.split('/');
+    for (QString &segment : segments)
+        segment = QString::fromLatin1(QUrl::toPercentEncoding(segment));
+    return segments.join('/');
+}
+
+QString reportFiles(const QStringList &files)
+{
+    QStringList names;
+    for (const QString &file : files)
+        names.append(file.startsWith("data:") ? QString("(inline)") : file);
+    return names.join(' ');
+}
+}
+
+ResponsiveImages::ResponsiveImages(const QString &outputDir, const QString &subdir)
+    : outputDir(outputDir), subdir(subdir)
+{
+}
+
+void ResponsiveImages::setQuality(int quality)
+{
+    this->quality = qBound(1, quality, 100);
+}
+
+void ResponsiveImages::setBundle(AssetBundle *bundle)
+{
+    this->bundle = bundle;
+}
+
+QString ResponsiveImages::key(const QString &source, const QSize &size)
+{
+    return source + '\n' + QString::number(size.width()) + 'x' + QString::number(size.height());
+}
+
+void ResponsiveImages::add(const HtmlExporter::ItemSnapshot &item)
+{
+    if (item.kind != HtmlExporter::ItemSnapshot::Image || item.width <= 0 || item.height <= 0)
+        return;
+    QSize size(item.width, item.height);
+    QString k = key(item.content, size);
+    if (index.contains(k))
+        return;
+    Asset asset;
+    asset.source = item.content;
+    asset.displaySize = size;
+    asset.stem = sanitizedStem(item.content) + '-' + QString::number(items.size());  // 序号避免同名图片冲突
+    index.insert(k, items.size());
+    items.append(asset);
+}
+
+void ResponsiveImages::encode(Asset &asset) const
+{
+    TraceSpan span("encode responsive image", "image");
+    asset.bytesBefore = QFileInfo(asset.source).size();
+
+    QImageReader reader(asset.source);
+    reader.setDecideFormatFromContent(true);  // 与编辑器一样按内容识别格式
+    QSize sourceSize = reader.size();
+
+    QVector<QSize> targets;
+    for (int density : Densities) {
+        QSize target = asset.displaySize * density;
+        if (sourceSize.isValid())
+            target = target.boundedTo(sourceSize);  // 不放大
+        if (targets.isEmpty() || target != targets.last())
+            targets.append(target);
+    }
+    // 原图不比显示尺寸大：重新编码只会再损失一次质量，PNG 还可能变成更大的 JPEG
+    if (targets.last() == sourceSize) {
+        asset.original = true;
+        asset.bytesAfter = asset.bytesBefore;
+        return;
+    }
+
+    // 最大的变体交给解码器直接缩放（JPEG 可在 DCT 阶段缩小，不必完整解码原图），
+    // 其余从它再缩小
+    reader.setScaledSize(targets.last());
+    QImage image = reader.read();
+    if (image.isNull()) {
+        asset.error = reader.errorString();
+        return;
+    }
+    // 预乘 ARGB32 和 RGB32 走 Qt 平滑缩放的 SSE4/AVX2/NEON 路径，其他格式会退回逐像素实现
+    const bool alpha = image.hasAlphaChannel();
+    image = image.convertToFormat(alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+    const char *format = alpha ? "png" : "jpg";
+
+    // 先全部编码到内存，确认比原图小后再写出
+    QVector<QByteArray> encoded(targets.size());
+    for (int i = targets.size() - 1; i >= 0; --i) {
+        const QSize &target = targets[i];
+        QImage variant = image.size() == target ? image
+                                                : image.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        QBuffer buffer(&encoded[i]);
+        buffer.open(QIODevice::WriteOnly);
+        if (!variant.save(&buffer, format, alpha ? -1 : quality)) {
+            asset.error = "cannot encode " + asset.source;
+            return;
+        }
+    }
+    // 高分屏下载的是最大的变体，它比原图还大时直接使用原图
+    if (asset.bytesBefore > 0 && encoded.last().size() > asset.bytesBefore) {
+        asset.original = true;
+        asset.bytesAfter = asset.bytesBefore;
+        return;
+    }
+
+    QStringList files;
+    QVector<int> widths;
+    qint64 bytes = 0;
+    for (int i = 0; i < targets.size(); ++i) {
+        const QByteArray &data = encoded[i];
+        QString name;
+        if (bundle) {
+            name = bundle->addData(data, format, &asset.error);
+            if (name.isEmpty())
+                return;
+        } else {
+            name = subdir + '/' + asset.stem + '-' + QString::number(targets[i].width()) + "w." + format;
+            QSaveFile file(outputDir + '/' + name);
+            if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+                asset.error = file.errorString();
+                return;
+            }
+        }
+        files.append(name);
+        widths.append(targets[i].width());
+        bytes += data.size();
+    }
+    asset.files = files;
+    asset.widths = widths;
+    asset.bytesAfter = bytes;
+}
+
+bool ResponsiveImages::build(bool parallel)
+{
+    TraceSpan span("build responsive images", "image");
+    if (items.isEmpty())
+        return true;
+    if (!bundle && !QDir(outputDir).mkpath(subdir)) {
+        for (Asset &asset : items)
+            asset.error = "cannot create " + subdir;
+        return false;
+    }
+
+    auto run = [this](Asset &asset) { encode(asset); };
+    if (parallel) {
+        QtConcurrent::blockingMap(items, run);
+    } else {
+        for (Asset &asset : items)
+            run(asset);
+    }
+    return std::none_of(items.cbegin(), items.cend(), [](const Asset &asset) { return !asset.error.isEmpty(); });
+}
+
+bool ResponsiveImages::resolve(const HtmlExporter::ItemSnapshot &item, HtmlExporter::ImageRef *ref) const
+{
+    auto it = index.constFind(key(item.content, QSize(item.width, item.height)));
+    if (it == index.cend())
+        return false;
+    const Asset &asset = items[it.value()];
+    if (!asset.error.isEmpty() || asset.original || asset.files.isEmpty())
+        return false;  // 使用原图
+
+    ref->src = urlPath(asset.files.first());
+    ref->srcset.clear();
+    ref->sizes.clear();
+    if (asset.files.size() > 1) {
+        for (int i = 0; i < asset.files.size(); ++i) {
+            if (i > 0)
+                ref->srcset += ", ";
+            ref->srcset += urlPath(asset.files[i]) + ' ' + QString::number(asset.widths[i]) + 'w';
+        }
+        ref->sizes = QString::number(item.width) + "px";
+    }
+    return true;
+}
+
+const QVector<ResponsiveImages::Asset> &ResponsiveImages::assets() const
+{
+    return items;
+}
+
+QString ResponsiveImages::report() const
+{
+    QString text;
+    qint64 before = 0;
+    qint64 after = 0;
+    for (const Asset &asset : items) {
+        bool ok = asset.error.isEmpty();
+        qint64 newBytes = ok ? asset.bytesAfter : asset.bytesBefore;
+        QString files = asset.original ? QString("(original)") : reportFiles(asset.files);
+        before += asset.bytesBefore;
+        after += newBytes;
+        double saved = asset.bytesBefore > 0 ? 100.0 * (asset.bytesBefore - newBytes) / asset.bytesBefore : 0;
+        text += QString("%1\t%2\t%3%\t%4x%5\t%6\t%7\n")
+                    .arg(asset.bytesBefore)
+                    .arg(newBytes)
+                    .arg(saved, 0, 'f', 1)
+                    .arg(asset.displaySize.width())
+                    .arg(asset.displaySize.height())
+                    .arg(asset.source, ok ? files : asset.error);
+    }
+    double saved = before > 0 ? 100.0 * (before - after) / before : 0;
+    text += QString("total\t%1\t%2\t%3%\t%4 images\n").arg(before).arg(after).arg(saved, 0, 'f', 1).arg(items.size());
+    return text;
+}
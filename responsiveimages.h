@@ -0,0 +1,59 @@
+#ifndef RESPONSIVEIMAGES_H
+#define RESPONSIVEIMAGES_H
+
+#include "htmlexporter.h"
+#include <QHash>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class AssetBundle;
+
+// 导出用的响应式图片：每张图片按页面上的显示尺寸和 2 倍尺寸重新编码，
+// 导出的 <img> 带上 srcset/sizes，浏览器不必下载原图再缩小。
+// 先在 GUI 线程收集需要的图片，build() 在线程池中并行解码、缩放、编码，
+// 之后 resolve() 只读查询，可直接作为 HtmlExporter 的 ImageResolver。
+// 设置了 AssetBundle 时变体交给它按内容哈希命名保存，不再写入 subdir
+class ResponsiveImages
+{
+public:
+    struct Asset {
+        QString source;
+        QSize displaySize;
+        QString stem;          // 输出文件名前缀，已去掉不适合放进 URL 的字符
+        QStringList files;     // 页面中的地址（相对导出目录或 data URI），从小到大
+        QVector<int> widths;   // 与 files 对应的像素宽度
+        qint64 bytesBefore = 0;
+        qint64 bytesAfter = 0;  // 各变体之和
+        QString error;          // 非空时导出仍使用原图
+        bool original = false;  // 原图不比显示尺寸大，或重新编码后反而更大，导出直接使用原图
+    };
+
+    // 变体写入 outputDir/subdir，页面中的地址相对 outputDir
+    ResponsiveImages(const QString &outputDir, const QString &subdir);
+
+    void setQuality(int quality);  // JPEG 质量，默认 85
+    void setBundle(AssetBundle *bundle);
+    void add(const HtmlExporter::ItemSnapshot &item);  // 文字项直接忽略；相同图片和尺寸只生成一次
+    bool build(bool parallel = true);                  // 全部成功时返回 true
+    bool resolve(const HtmlExporter::ItemSnapshot &item, HtmlExporter::ImageRef *ref) const;
+
+    const QVector<Asset> &assets() const;
+    // 每张图片一行：原大小、新大小（各变体之和）、节省比例、显示尺寸、原图、生成的文件或错误信息，
+    // 保留原图的记为 (original)，最后一行为合计
+    QString report() const;
+
+private:
+    static QString key(const QString &source, const QSize &size);
+    void encode(Asset &asset) const;
+
+    QString outputDir;
+    QString subdir;
+    int quality = 85;
+    AssetBundle *bundle = nullptr;
+    QVector<Asset> items;
+    QHash<QString, int> index;
+};
+
+#endif // RESPONSIVEIMAGES_H
@@ -0,0 +1,162 @@
+#include "snapindex.h"
+#include <algorithm>
+#include <cmath>
+
+qreal SnapIndex::guideValue(Guide guide, const QRectF &rect)
+{
+    switch (guide) {
+    case Left:    return rect.left();
+    case CenterX: return rect.center().x();
+    case Top:     return rect.top();
+    case CenterY: return rect.center().y();
+    default:      break;
+    }
+    return 0;
+}
+
+void SnapIndex::insertEntry(QVector<Entry> &entries, qreal value, QGraphicsItem *item)
+{
+    auto it = std::upper_bound(entries.begin(), entries.end(), value,
+                               [](qreal v, const Entry &e) { return v < e.value; });
+    entries.insert(it, Entry{value, item});
+}
+
+void SnapIndex::removeEntry(QVector<Entry> &entries, qreal value, QGraphicsItem *item)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), value,
+                               [](const Entry &e, qreal v) { return e.value < v; });
+    for (; it != entries.end() && it->value == value; ++it) {
+        if (it->item == item) {
+            entries.erase(it);
+            return;
+        }
+    }
+}
+
+void SnapIndex::insert(QGraphicsItem *item, const QRectF &sceneRect)
+{
+    if (rects.contains(item)) {
+        update(item, sceneRect);
+        return;
+    }
+    rects.insert(item, sceneRect);
+    for (int g = 0; g < GuideCount; ++g)
+        insertEntry(guides[g], guideValue(Guide(g), sceneRect), item);
+}
+
+void SnapIndex::update(QGraphicsItem *item, const QRectF &sceneRect)
+{
+    auto it = rects.find(item);
+    if (it == rects.end()) {
+        insert(item, sceneRect);
+        return;
+    }
+    if (it.value() == sceneRect)
+        return;
+
+    for (int g = 0; g < GuideCount; ++g) {
+        qreal oldValue = guideValue(Guide(g), it.value());
+        qreal newValue = guideValue(Guide(g), sceneRect);
+        if (oldValue == newValue)
+            continue;  // 例如只发生水平移动时，上边和垂直中心不变
+        removeEntry(guides[g], oldValue, item);
+        insertEntry(guides[g], newValue, item);
+    }
+    it.value() = sceneRect;
+}
+
+void SnapIndex::remove(QGraphicsItem *item)
+{
+    auto it = rects.find(item);
+    if (it == rects.end())
+        return;
+    for (int g = 0; g < GuideCount; ++g)
+        removeEntry(guides[g], guideValue(Guide(g), it.value()), item);
+    rects.erase(it);
+}
+
+void SnapIndex::update(const QVector<Change> &changes)
+{
+    QSet<QGraphicsItem *> items;
+    items.reserve(changes.size());
+    for (const Change &change : changes)
+        items.insert(change.item);
+    remove(items);
+
+    // 新条目排好序后与原数组归并，代价 O(n + k log k)
+    auto less = [](const Entry &a, const Entry &b) { return a.value < b.value; };
+    for (int g = 0; g < GuideCount; ++g) {
+        QVector<Entry> &entries = guides[g];
+        qsizetype oldSize = entries.size();
+        entries.reserve(oldSize + changes.size());
+        for (const Change &change : changes)
+            entries.append(Entry{guideValue(Guide(g), change.sceneRect), change.item});
+        std::stable_sort(entries.begin() + oldSize, entries.end(), less);
+        std::inplace_merge(entries.begin(), entries.begin() + oldSize, entries.end(), less);
+    }
+    for (const Change &change : changes)
+        rects.insert(change.item, change.sceneRect);
+}
+
+void SnapIndex::remove(const QSet<QGraphicsItem *> &items)
+{
+    qsizetype removed = 0;
+    for (QGraphicsItem *item : items)
+        removed += rects.remove(item) ? 1 : 0;
+    if (removed == 0)
+        return;
+    for (auto &entries : guides)
+        entries.removeIf([&items](const Entry &e) { return items.contains(e.item); });
+}
+
+void SnapIndex::clear()
+{
+    for (auto &entries : guides)
+        entries.clear();
+    rects.clear();
+}
+
+bool SnapIndex::contains(QGraphicsItem *item) const
+{
+    return rects.contains(item);
+}
+
+int SnapIndex::size() const
+{
+    return rects.size();
+}
+
+bool SnapIndex::nearest(Guide guide, qreal value, qreal threshold,
+                        const QGraphicsItem *exclude, qreal *result) const
+{
+    const QVector<Entry> &entries = guides[guide];
+    auto pivot = std::lower_bound(entries.cbegin(), entries.cend(), value,
+                                  [](const Entry &e, qreal v) { return e.value < v; });
+
+    // 从二分位置向两侧扩展，跳过被拖动的图形项本身
+    auto up = pivot;
+    while (up != entries.cend() && up->item == exclude)
+        ++up;
+    auto down = pivot;
+    bool hasDown = false;
+    while (down != entries.cbegin()) {
+        --down;
+        if (down->item != exclude) {
+            hasDown = true;
+            break;
+        }
+    }
+
+    qreal best = threshold;
+    bool found = false;
+    if (up != entries.cend() && std::abs(up->value - value) < best) {
+        best = std::abs(up->value - value);
+        *result = up->value;
+        found = true;
+    }
+    if (hasDown && std::abs(down->value - value) < best) {
+        *result = down->value;
+        found = true;
+    }
+    return found;
+}
@@ -0,0 +1,58 @@
+#ifndef SNAPINDEX_H
+#define SNAPINDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QRectF>
+
+class QGraphicsItem;
+
+// 吸附候选索引：按左边、水平中心、上边、垂直中心分别维护有序数组，
+// 查询时二分定位，只检查阈值范围内的相邻参考线
+class SnapIndex
+{
+public:
+    enum Guide {
+        Left,
+        CenterX,
+        Top,
+        CenterY,
+        GuideCount
+    };
+
+    struct Change {
+        QGraphicsItem *item;
+        QRectF sceneRect;
+    };
+
+    void insert(QGraphicsItem *item, const QRectF &sceneRect);
+    void update(QGraphicsItem *item, const QRectF &sceneRect);
+    void remove(QGraphicsItem *item);
+    // 批量版本：每个有序数组只过滤一遍、合并一次，适合一次改动大量图形项
+    void update(const QVector<Change> &changes);
+    void remove(const QSet<QGraphicsItem *> &items);
+    void clear();
+
+    bool contains(QGraphicsItem *item) const;
+    int size() const;
+
+    // 查找距离 value 最近且小于 threshold 的参考线，exclude 为正在拖动的图形项
+    bool nearest(Guide guide, qreal value, qreal threshold,
+                 const QGraphicsItem *exclude, qreal *result) const;
+
+private:
+    struct Entry {
+        qreal value;
+        QGraphicsItem *item;
+    };
+
+    static qreal guideValue(Guide guide, const QRectF &rect);
+    void insertEntry(QVector<Entry> &entries, qreal value, QGraphicsItem *item);
+    void removeEntry(QVector<Entry> &entries, qreal value, QGraphicsItem *item);
+
+    QVector<Entry> guides[GuideCount];
+    QHash<QGraphicsItem *, QRectF> rects;  // 记录旧位置，用于删除时定位
+};
+
+#endif // SNAPINDEX_H
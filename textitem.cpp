@@ -1,4 +1,6 @@
 #include "textitem.h"
+#include "layouteditor.h"
+#include "htmlexporter.h"
 #include <QPainter>
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsSceneContextMenuEvent>
@@ -7,6 +9,8 @@
 #include <QStyleOptionGraphicsItem>
 #include <QtMath>
 #include <QTextCursor>
+#include <QTextDocument>
+#include <QAbstractTextDocumentLayout>
 
 TextItem::TextItem(QGraphicsItem *parent)
     : QGraphicsTextItem(parent)
@@ -14,6 +18,7 @@ TextItem::TextItem(QGraphicsItem *parent)
     // 设置默认行为
     setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable);
     setAcceptHoverEvents(true);
+    watchGeometry();
 }
 
 TextItem::TextItem(const QString &text, QGraphicsItem *parent)
@@ -23,10 +28,46 @@ TextItem::TextItem(const QString &text, QGraphicsItem *parent)
              QGraphicsItem::ItemIsSelectable |
              QGraphicsItem::ItemIsFocusable);
     setTextInteractionFlags(Qt::NoTextInteraction);
+    watchGeometry();
+}
+
+void TextItem::watchGeometry()
+{
+    // 非编辑状态下按设备坐标缓存绘制结果，文字、字体、颜色、选中状态变化时
+    // Qt 会调用 update() 使缓存失效，缩放变化时按新的变换重新生成
+    setCacheMode(DeviceCoordinateCache);
+    setFlag(ItemSendsGeometryChanges);
+    // 字体或文字变化会改变尺寸，同样需要刷新吸附索引
+    QObject::connect(document()->documentLayout(), &QAbstractTextDocumentLayout::documentSizeChanged,
+                     this, [this]() {
+                         if (auto *editor = LayoutEditor::fromScene(scene()))
+                             editor->itemGeometryChanged(this);
+                     });
+    // 尺寸不变的文字修改只需要记入自动保存
+    QObject::connect(document(), &QTextDocument::contentsChanged, this, [this]() {
+        if (auto *editor = LayoutEditor::fromScene(scene()))
+            editor->itemContentChanged(this);
+    });
+}
+
+QVariant TextItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    if (change == ItemFlagsChange)
+        return QVariant(value.toUInt() | ItemSendsGeometryChanges);
+
+    LayoutEditor::trackItemChange(this, change);
+    return QGraphicsTextItem::itemChange(change, value);
+}
+
+void TextItem::setEditing(bool editing)
+{
+    // 编辑时光标闪烁和选区每次都要重绘，缓存没有意义，直接实时绘制
+    setCacheMode(editing ? NoCache : DeviceCoordinateCache);
 }
 
 void TextItem::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event)
 {
+    setEditing(true);
     setTextInteractionFlags(Qt::TextEditorInteraction); // 双击后启用编辑
     setFocus(Qt::MouseFocusReason);                     // 获取焦点
     setFlag(ItemIsMovable, false);
@@ -46,26 +87,14 @@ void TextItem::focusOutEvent(QFocusEvent *event)
     // 清除焦点
     clearFocus();
     QGraphicsTextItem::focusOutEvent(event);
+    setEditing(false);
 }
 
 QString TextItem::toHtml() const
 {
-    QPointF pos = scenePos();
-    QFont font = this->font();
-    QColor color = this->defaultTextColor();
-
-    QString style = QString("position:absolute; left:%1px; top:%2px; "
-                            "font-family:'%3'; font-size:%4pt; font-weight:%5; color:%6;")
-                        .arg(int(pos.x()))
-                        .arg(int(pos.y()))
-                        .arg(font.family())
-                        .arg(font.pointSize())
-                        .arg(font.bold() ? "bold" : "normal")
-                        .arg(color.name());  // 输出为 "#RRGGBB"
-
-    return QString("<div style=\"%1\">%2</div>\n")
-        .arg(style)
-        .arg(this->toPlainText().toHtmlEscaped());
+    QByteArray html;
+    HtmlExporter::appendText(html, this);  // 样式格式与导出保持一致
+    return QString::fromUtf8(html);
 }
 
 QRectF TextItem::boundingRect() const
@@ -76,9 +105,13 @@ QRectF TextItem::boundingRect() const
 
 QPainterPath TextItem::shape() const
 {
-    QPainterPath path;
-    path.addRect(boundingRect());
-    return path;
+    QRectF rect = boundingRect();
+    if (rect != shapeRect) {
+        shapeRect = rect;
+        shapePath = QPainterPath();
+        shapePath.addRect(rect);
+    }
+    return shapePath;
 }
 
 void TextItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
@@ -91,14 +124,31 @@ void TextItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
         painter->drawRect(rect);
     }
 }
+// 悬停边框画在缓存里，进出时 Qt 不会使缓存失效，需要自己刷新
+void TextItem::hoverEnterEvent(QGraphicsSceneHoverEvent *event)
+{
+    QGraphicsTextItem::hoverEnterEvent(event);
+    update();
+}
+
+void TextItem::hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
+{
+    QGraphicsTextItem::hoverLeaveEvent(event);
+    update();
+}
+
 void TextItem::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
 {
     QMenu menu;
     QAction *deleteAction = menu.addAction("删除");
     QAction *selectedAction = menu.exec(event->screenPos());
     if (selectedAction == deleteAction) {
-        scene()->removeItem(this);
-        delete this;
+        if (auto *editor = LayoutEditor::fromScene(scene())) {
+            editor->deleteItems({ this });  // 可撤销
+        } else {
+            scene()->removeItem(this);
+            delete this;
+        }
     }
 }
 
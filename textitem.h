@@ -2,6 +2,7 @@
 #define TEXTITEM_H
 
 #include <QGraphicsTextItem>
+#include <QPainterPath>
 #include <QStyleOptionGraphicsItem>
 
 class TextItem : public QGraphicsTextItem
@@ -15,16 +16,25 @@ public:
 
 protected:
     void focusOutEvent(QFocusEvent *event) override;
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
 
 protected:
     void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
+    void hoverEnterEvent(QGraphicsSceneHoverEvent *event) override;
+    void hoverLeaveEvent(QGraphicsSceneHoverEvent *event) override;
 
 
 private:
     QPointF dragOffset;
+    void watchGeometry();
+    void setEditing(bool editing);
+
+    // shape 只在边界变化时重建
+    mutable QRectF shapeRect;
+    mutable QPainterPath shapePath;
 
 };
 
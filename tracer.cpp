@@ -0,0 +1,144 @@
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <cstring>
+
+std::atomic<bool> Tracer::enabled(false);
+
+namespace {
+struct Event {
+    const char *name;
+    const char *category;
+    int tid;
+    qint64 startNs;
+    qint64 durationNs;
+};
+
+struct ThreadName {
+    int tid;
+    QByteArray name;
+};
+
+QMutex mutex;
+QElapsedTimer traceClock;  // 不能叫 clock，会与 <time.h> 的 ::clock() 冲突
+QString outputPath;
+QVector<Event> events;
+QVector<ThreadName> threadNames;
+std::atomic<int> nextTid(1);
+thread_local int currentTid = 0;
+
+// 每个线程第一次记录时分配一个小整数作为线程号，并登记线程名
+int threadId()
+{
+    if (currentTid)
+        return currentTid;
+    currentTid = nextTid.fetch_add(1);
+
+    QThread *thread = QThread::currentThread();
+    QByteArray name = thread->objectName().toUtf8();
+    if (name.isEmpty()) {
+        bool gui = QCoreApplication::instance() && QCoreApplication::instance()->thread() == thread;
+        name = gui ? QByteArray("GUI") : QByteArray("worker");
+    }
+    // 线程池的线程都叫 "Thread (pooled)"，加上线程号才能在 Perfetto 中区分
+    name += " " + QByteArray::number(currentTid);
+    QMutexLocker locker(&mutex);
+    threadNames.append({ currentTid, name });
+    return currentTid;
+}
+
+void appendEscaped(QByteArray &out, const QByteArray &text)
+{
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+}
+
+QByteArray microseconds(qint64 ns)
+{
+    return QByteArray::number(ns / 1000.0, 'f', 3);
+}
+}
+
+void Tracer::startFromArguments(int argc, char *argv[])
+{
+    QString path = qEnvironmentVariable("HTMLEDITOR_TRACE");
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            path = QString::fromLocal8Bit(argv[i + 1]);
+        else if (strncmp(argv[i], "--trace=", 8) == 0)
+            path = QString::fromLocal8Bit(argv[i] + 8);
+    }
+    if (!path.isEmpty())
+        start(path);
+}
+
+void Tracer::start(const QString &filePath)
+{
+    QMutexLocker locker(&mutex);
+    outputPath = filePath;
+    events.clear();
+    events.reserve(4096);
+    traceClock.start();
+    enabled.store(true);
+}
+
+qint64 Tracer::now()
+{
+    return traceClock.nsecsElapsed();
+}
+
+void Tracer::record(const char *name, const char *category, qint64 startNs, qint64 endNs)
+{
+    if (!isEnabled())
+        return;
+    int tid = threadId();
+    QMutexLocker locker(&mutex);
+    events.append({ name, category, tid, startNs, endNs - startNs });
+}
+
+bool Tracer::finish()
+{
+    if (!enabled.exchange(false))
+        return true;
+
+    QMutexLocker locker(&mutex);
+    QByteArray json;
+    json.reserve(events.size() * 96 + 256);
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    bool first = true;
+    for (const ThreadName &thread : std::as_const(threadNames)) {
+        json += first ? "" : ",\n";
+        first = false;
+        json += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + pid
+                + ",\"tid\":" + QByteArray::number(thread.tid) + ",\"args\":{\"name\":\"";
+        appendEscaped(json, thread.name);
+        json += "\"}}";
+    }
+    for (const Event &event : std::as_const(events)) {
+        json += first ? "" : ",\n";
+        first = false;
+        json += "{\"ph\":\"X\",\"name\":\"";
+        appendEscaped(json, event.name);
+        json += "\",\"cat\":\"";
+        appendEscaped(json, event.category);
+        json += "\",\"pid\":" + pid + ",\"tid\":" + QByteArray::number(event.tid)
+                + ",\"ts\":" + microseconds(event.startNs)
+                + ",\"dur\":" + microseconds(event.durationNs) + "}";
+    }
+    json += "\n]}\n";
+    events.clear();
+
+    QSaveFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size())
+        return false;
+    return file.commit();
+}
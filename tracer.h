@@ -0,0 +1,50 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <atomic>
+
+// 性能跟踪：记录带线程号的耗时区间，程序退出时写成 Chrome trace-event JSON，
+// 可直接在 Perfetto 或 chrome://tracing 中打开。
+// 用环境变量 HTMLEDITOR_TRACE=<文件> 或命令行参数 --trace <文件> 开启；
+// 未开启时每个区间只有一次原子读取
+class Tracer
+{
+public:
+    static void startFromArguments(int argc, char *argv[]);
+    static void start(const QString &filePath);
+    static bool finish();  // 写出文件并停止记录
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static qint64 now();
+    // name 和 category 必须是字符串常量
+    static void record(const char *name, const char *category, qint64 startNs, qint64 endNs);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+// 作用域内的一个区间
+class TraceSpan
+{
+public:
+    TraceSpan(const char *name, const char *category)
+        : name(name), category(category), start(Tracer::isEnabled() ? Tracer::now() : -1)
+    {
+    }
+    ~TraceSpan()
+    {
+        if (start >= 0)
+            Tracer::record(name, category, start, Tracer::now());
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name;
+    const char *category;
+    qint64 start;
+};
+
+#endif // TRACER_H
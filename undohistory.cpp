@@ -0,0 +1,294 @@
+#include "undohistory.h"
+#include "layouteditor.h"
+#include "layouteditoritem.h"
+#include "textitem.h"
+#include <QGraphicsItemGroup>
+#include <QGraphicsScene>
+#include <QTextDocument>
+#include <algorithm>
+
+namespace {
+bool itemLess(const UndoHistory::Move &a, const UndoHistory::Move &b)
+{
+    return a.item < b.item;
+}
+
+// 图形项及其子项持有的像素和文字
+qint64 itemBytes(const QGraphicsItem *item)
+{
+    qint64 total = 0;
+    if (auto *img = dynamic_cast<const LayoutEditorItem *>(item)) {
+        QPixmap pixmap = img->pixmap();
+        total += qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+    } else if (auto *text = dynamic_cast<const TextItem *>(item)) {
+        total += qint64(text->document()->characterCount()) * sizeof(QChar);
+    }
+    for (const QGraphicsItem *child : item->childItems())
+        total += itemBytes(child);
+    return total;
+}
+}
+
+bool UndoHistory::Entry::isEmpty() const
+{
+    return dissolved.isEmpty() && removals.isEmpty() && formed.isEmpty()
+           && moves.isEmpty() && resizes.isEmpty();
+}
+
+qint64 UndoHistory::Entry::bytes() const
+{
+    qint64 total = sizeof(Entry)
+                   + qint64(removals.size()) * sizeof(Removal)
+                   + qint64(moves.size()) * sizeof(Move)
+                   + qint64(resizes.size()) * sizeof(Resize);
+    // 删除的图形项撤销前一直由历史持有，按实际占用计入
+    for (const Removal &r : removals)
+        total += itemBytes(r.item);
+    for (const Grouping &g : dissolved)
+        total += sizeof(Grouping) + qint64(g.children.size()) * sizeof(QGraphicsItem *);
+    for (const Grouping &g : formed)
+        total += sizeof(Grouping) + qint64(g.children.size()) * sizeof(QGraphicsItem *);
+    return total;
+}
+
+UndoHistory::UndoHistory(QGraphicsScene *scene)
+    : scene(scene)
+{
+    // 默认 32MB，可用环境变量 HTMLEDITOR_UNDO_MB 调整
+    bool ok = false;
+    int megabytes = qEnvironmentVariableIntValue("HTMLEDITOR_UNDO_MB", &ok);
+    budget = qint64(ok && megabytes > 0 ? megabytes : 32) * 1024 * 1024;
+}
+
+UndoHistory::~UndoHistory()
+{
+    clear();
+}
+
+void UndoHistory::push(const Entry &entry)
+{
+    if (entry.isEmpty())
+        return;
+
+    // 新操作使可重做的记录失效
+    for (int i = entries.size() - 1; i >= done; --i) {
+        used -= entries[i].cost;
+        discard(entries[i], false);
+    }
+    entries.resize(done);
+
+    entries.append(entry);
+    entries.last().cost = entry.bytes();
+    used += entries.last().cost;
+    ++done;
+    trim();
+}
+
+void UndoHistory::pushMoves(QVector<Move> moves)
+{
+    if (moves.isEmpty())
+        return;
+    std::sort(moves.begin(), moves.end(), itemLess);
+
+    if (done > 0 && done == entries.size()) {
+        Entry &last = entries.last();
+        bool sameItems = last.mergeable && last.moves.size() == moves.size()
+                         && last.dissolved.isEmpty() && last.removals.isEmpty()
+                         && last.formed.isEmpty() && last.resizes.isEmpty();
+        for (int i = 0; sameItems && i < moves.size(); ++i)
+            sameItems = last.moves[i].item == moves[i].item;
+        if (sameItems) {
+            for (int i = 0; i < moves.size(); ++i)
+                last.moves[i].to = moves[i].to;
+            return;
+        }
+    }
+
+    Entry entry;
+    entry.moves = moves;
+    entry.mergeable = true;
+    push(entry);
+}
+
+void UndoHistory::apply(const Entry &entry, bool forward)
+{
+    LayoutEditor *editor = LayoutEditor::fromScene(scene);
+
+    auto dissolve = [this, editor](const Grouping &g) {
+        for (QGraphicsItem *child : g.children)
+            g.group->removeFromGroup(child);
+        if (editor)
+            editor->itemRemoved(g.group);
+        scene->removeItem(g.group);
+    };
+    // 组合没有位置变化通知，与 LayoutEditor::moveItems 一样统一登记到索引和自动保存
+    auto move = [editor](const Move &m, const QPointF &pos) {
+        m.item->setPos(pos);
+        if (editor)
+            editor->itemGeometryChanged(m.item);
+    };
+    auto form = [this, editor](const Grouping &g) {
+        scene->addItem(g.group);
+        for (QGraphicsItem *child : g.children)
+            g.group->addToGroup(child);
+        if (editor)
+            editor->itemGeometryChanged(g.group);
+    };
+
+    if (forward) {
+        for (const Grouping &g : entry.dissolved)
+            dissolve(g);
+        // 被删除的图形项每个都会触发一次 selectionChanged，先整体取消选中
+        if (std::any_of(entry.removals.cbegin(), entry.removals.cend(),
+                        [](const Removal &r) { return r.item->isSelected(); }))
+            scene->clearSelection();
+        for (const Removal &r : entry.removals)
+            scene->removeItem(r.item);
+        for (const Grouping &g : entry.formed)
+            form(g);
+        for (const Move &m : entry.moves)
+            move(m, m.to);
+        for (const Resize &r : entry.resizes) {
+            r.item->beginResize();
+            r.item->finishResize(r.to);
+        }
+    } else {
+        for (const Resize &r : entry.resizes) {
+            r.item->beginResize();
+            r.item->finishResize(r.from);
+        }
+        for (const Move &m : entry.moves)
+            move(m, m.from);
+        for (const Grouping &g : entry.formed)
+            dissolve(g);
+        for (const Removal &r : entry.removals) {
+            if (r.parent)
+                r.item->setParentItem(r.parent);
+            else
+                scene->addItem(r.item);
+        }
+        for (const Grouping &g : entry.dissolved)
+            form(g);
+    }
+}
+
+bool UndoHistory::canUndo() const
+{
+    return done > 0;
+}
+
+bool UndoHistory::canRedo() const
+{
+    return done < entries.size();
+}
+
+bool UndoHistory::undo()
+{
+    if (!canUndo())
+        return false;
+    --done;
+    entries[done].mergeable = false;
+    apply(entries[done], false);
+    return true;
+}
+
+bool UndoHistory::redo()
+{
+    if (!canRedo())
+        return false;
+    entries[done].mergeable = false;
+    apply(entries[done], true);
+    ++done;
+    return true;
+}
+
+void UndoHistory::forget(QGraphicsItem *item)
+{
+    for (Entry &entry : entries) {
+        qsizetype removed = entry.moves.removeIf([item](const Move &m) { return m.item == item; })
+                            + entry.resizes.removeIf([item](const Resize &r) { return r.item == item; })
+                            + entry.removals.removeIf([item](const Removal &r) { return r.item == item || r.parent == item; });
+        for (QVector<Grouping> *groupings : { &entry.dissolved, &entry.formed }) {
+            removed += groupings->removeIf([item](const Grouping &g) { return g.group == item; });
+            for (Grouping &g : *groupings)
+                removed += g.children.removeAll(item);
+        }
+        if (removed > 0) {
+            used -= entry.cost;
+            entry.cost = entry.bytes();
+            used += entry.cost;
+        }
+    }
+}
+
+QList<QGraphicsItem *> UndoHistory::retainedItems() const
+{
+    QList<QGraphicsItem *> items;
+    for (const Entry &entry : entries) {
+        for (const Removal &r : entry.removals) {
+            if (!r.item->scene())
+                items.append(r.item);
+        }
+        for (const QVector<Grouping> *groupings : { &entry.dissolved, &entry.formed }) {
+            for (const Grouping &g : *groupings) {
+                if (!g.group->scene())
+                    items.append(g.group);
+            }
+        }
+    }
+    return items;
+}
+
+void UndoHistory::discard(Entry &entry, bool applied)
+{
+    // 只有不在场景中的图形项归历史所有；已执行的删除和解散、未执行的组合会留下这样的图形项
+    if (applied) {
+        for (const Removal &r : entry.removals) {
+            if (!r.item->scene())
+                delete r.item;
+        }
+        for (const Grouping &g : entry.dissolved) {
+            if (!g.group->scene())
+                delete g.group;
+        }
+    } else {
+        for (const Grouping &g : entry.formed) {
+            if (!g.group->scene())
+                delete g.group;
+        }
+    }
+}
+
+void UndoHistory::trim()
+{
+    int dropped = 0;
+    while (used > budget && dropped < done - 1) {
+        used -= entries[dropped].cost;
+        discard(entries[dropped], true);
+        ++dropped;
+    }
+    if (dropped > 0) {
+        entries.remove(0, dropped);
+        done -= dropped;
+    }
+}
+
+void UndoHistory::clear()
+{
+    for (int i = 0; i < entries.size(); ++i)
+        discard(entries[i], i < done);
+    entries.clear();
+    done = 0;
+    used = 0;
+}
+
+void UndoHistory::setBudget(qint64 bytes)
+{
+    budget = bytes;
+    trim();
+}
+
+qint64 UndoHistory::bytesUsed() const
+{
+    return used;
+}
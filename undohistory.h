@@ -0,0 +1,86 @@
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <QList>
+#include <QPointF>
+#include <QSizeF>
+#include <QVector>
+
+class QGraphicsScene;
+class QGraphicsItem;
+class QGraphicsItemGroup;
+class LayoutEditorItem;
+
+// 撤销历史：每一步只记录受影响图形项的变化量，不保存场景快照。
+// 删除的图形项和解散的组合不会立即析构，由历史持有，记录被丢弃时才释放。
+// 总占用（包括历史持有的图形项的像素和文字）超出预算时丢弃最早的记录
+class UndoHistory
+{
+public:
+    struct Move {
+        QGraphicsItem *item;
+        QPointF from;
+        QPointF to;
+    };
+    struct Resize {
+        LayoutEditorItem *item;
+        QSizeF from;
+        QSizeF to;
+    };
+    struct Removal {
+        QGraphicsItem *item;
+        QGraphicsItem *parent;
+    };
+    struct Grouping {
+        QGraphicsItemGroup *group;
+        QList<QGraphicsItem *> children;
+    };
+
+    // 一步操作；执行时依次解散组合、删除、建立组合、移动、缩放，撤销时反过来
+    struct Entry {
+        QVector<Grouping> dissolved;
+        QVector<Removal> removals;
+        QVector<Grouping> formed;
+        QVector<Move> moves;
+        QVector<Resize> resizes;
+        bool mergeable = false;  // 拖动和方向键产生的移动，可与下一次移动合并
+        qint64 cost = 0;         // 记入历史时的 bytes()，只在记录变化时重新计算
+
+        bool isEmpty() const;
+        qint64 bytes() const;  // 变化量加上删除、解散时保留的图形项的实际占用
+    };
+
+    explicit UndoHistory(QGraphicsScene *scene);
+    ~UndoHistory();
+
+    // 记录已经在场景中完成的操作
+    void push(const Entry &entry);
+    // 与上一步移动的图形项完全相同时合并为一步
+    void pushMoves(QVector<Move> moves);
+
+    // 把记录的操作重新作用到场景上，供 LayoutEditor 执行删除、组合等操作时复用
+    void apply(const Entry &entry, bool forward);
+
+    bool canUndo() const;
+    bool canRedo() const;
+    bool undo();
+    bool redo();
+
+    void forget(QGraphicsItem *item);  // 图形项在历史之外被析构时调用
+    QList<QGraphicsItem *> retainedItems() const;  // 由历史持有、当前不在场景中的图形项
+    void clear();
+    void setBudget(qint64 bytes);
+    qint64 bytesUsed() const;
+
+private:
+    void discard(Entry &entry, bool applied);
+    void trim();
+
+    QGraphicsScene *scene;
+    QVector<Entry> entries;  // 前 done 条已执行，其后为可重做的记录
+    int done = 0;
+    qint64 used = 0;
+    qint64 budget;
+};
+
+#endif // UNDOHISTORY_H